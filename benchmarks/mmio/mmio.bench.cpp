@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+#include "mmio/mmio.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	constexpr std::size_t file_size = std::size_t{ 64 } << 20;
+	constexpr int repetitions = 20;
+
+	// stand-ins for the accessors as they were when they lived out-of-line in the library,
+	// called through volatile pointers so the optimizer can't see through them
+	[[nodiscard]] auto opaque_data(const mmio::mapped_file_source& a_file) noexcept
+		-> const std::byte*
+	{
+		return a_file.data();
+	}
+
+	[[nodiscard]] auto opaque_size(const mmio::mapped_file_source& a_file) noexcept
+		-> std::size_t
+	{
+		return a_file.size();
+	}
+
+	auto (*volatile data_fn)(const mmio::mapped_file_source&) noexcept -> const std::byte* = opaque_data;
+	auto (*volatile size_fn)(const mmio::mapped_file_source&) noexcept -> std::size_t = opaque_size;
+
+	// the common pattern of re-evaluating the accessors every iteration
+	[[nodiscard]] auto sum_inline(const mmio::mapped_file_source& a_file) noexcept
+		-> std::uint64_t
+	{
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < a_file.size(); ++i) {
+			sum += std::to_integer<std::uint8_t>(a_file.data()[i]);
+		}
+		return sum;
+	}
+
+	[[nodiscard]] auto sum_opaque(const mmio::mapped_file_source& a_file) noexcept
+		-> std::uint64_t
+	{
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < size_fn(a_file); ++i) {
+			sum += std::to_integer<std::uint8_t>(data_fn(a_file)[i]);
+		}
+		return sum;
+	}
+
+	[[nodiscard]] auto sum_hoisted(const mmio::mapped_file_source& a_file) noexcept
+		-> std::uint64_t
+	{
+		std::uint64_t sum = 0;
+		for (const auto byte : a_file) {
+			sum += std::to_integer<std::uint8_t>(byte);
+		}
+		return sum;
+	}
+
+	template <class F>
+	void run(std::string_view a_name, const mmio::mapped_file_source& a_file, F a_func)
+	{
+		auto best = std::chrono::steady_clock::duration::max();
+		std::uint64_t sum = 0;
+		for (int i = 0; i < repetitions; ++i) {
+			const auto start = std::chrono::steady_clock::now();
+			sum = a_func(a_file);
+			best = (std::min)(best, std::chrono::steady_clock::now() - start);
+		}
+
+		const auto seconds = std::chrono::duration<double>(best).count();
+		std::printf(
+			"%-20.*s %8.3f ms %8.2f GiB/s (sum %llu)\n",
+			static_cast<int>(a_name.size()),
+			a_name.data(),
+			seconds * 1000.0,
+			static_cast<double>(a_file.size()) / seconds / (1 << 30),
+			static_cast<unsigned long long>(sum));
+	}
+}
+
+int main()
+{
+	const std::filesystem::path filePath{ "mmio_bench.bin"sv };
+	{
+		mmio::mapped_file_sink sink{ filePath, file_size };
+		for (std::size_t i = 0; i < sink.size(); ++i) {
+			sink.data()[i] = static_cast<std::byte>(i * 31);
+		}
+	}
+
+	{
+		const mmio::mapped_file_source source{ filePath };
+		run("hoisted pointers"sv, source, sum_hoisted);
+		run("inline accessors"sv, source, sum_inline);
+		run("opaque accessors"sv, source, sum_opaque);
+	}
+
+	std::filesystem::remove(filePath);
+	return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	// A read-only mapping of a file which another process is still appending to.
+	// On linux, a large range of address space is reserved up front, and the mapping is extended in place as the file grows,
+	// so `data()` stays put and previously mapped pages stay warm. If the file outgrows the reservation, a larger one
+	// is made, and `data()` moves. On windows, the view is recreated whenever the file grows, so `data()` may always move.
+	class mapped_file_follower final
+	{
+	public:
+		using value_type = const std::byte;
+		using iterator = value_type*;
+
+		static constexpr std::size_t default_reserve =
+			sizeof(void*) >= 8 ?
+				static_cast<std::size_t>(std::uint64_t{ 1 } << 36) :
+				std::size_t{ 1 } << 28;
+
+		mapped_file_follower() noexcept = default;
+		mapped_file_follower(const mapped_file_follower&) = delete;
+		mapped_file_follower(mapped_file_follower&& a_rhs) noexcept { this->do_move(std::move(a_rhs)); }
+		mapped_file_follower(std::filesystem::path a_path, std::size_t a_reserve = default_reserve);
+
+		~mapped_file_follower() noexcept { this->close(); }
+
+		mapped_file_follower& operator=(const mapped_file_follower&) = delete;
+		mapped_file_follower& operator=(mapped_file_follower&& a_rhs) noexcept
+		{
+			if (this != &a_rhs) {
+				this->close();
+				this->do_move(std::move(a_rhs));
+			}
+			return *this;
+		}
+
+		[[nodiscard]] auto begin() const noexcept -> iterator { return this->data(); }
+		[[nodiscard]] auto end() const noexcept -> iterator { return this->data() + this->size(); }
+
+		void close() noexcept;
+		[[nodiscard]] auto data() const noexcept -> value_type*;
+		[[nodiscard]] bool empty() const noexcept { return this->size() == 0; }
+		[[nodiscard]] bool is_open() const noexcept;
+
+		[[nodiscard]] auto native_handle() const noexcept
+			-> const native_handle_type&
+		{
+			return this->_handle;
+		}
+
+		auto open(
+			std::filesystem::path a_path,
+			std::size_t a_reserve = default_reserve) noexcept
+			-> open_result;
+
+		// makes any bytes appended since the last call visible, without blocking
+		auto refresh() noexcept -> open_result;
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t { return this->_size; }
+
+		// blocks until the file has grown past `size()`, or fails with `std::errc::timed_out`
+		auto wait(std::chrono::milliseconds a_timeout) noexcept -> open_result;
+
+	private:
+		void do_move(mapped_file_follower&& a_rhs) noexcept
+		{
+			this->_handle = std::exchange(a_rhs._handle, native_handle_type{});
+			this->_size = std::exchange(a_rhs._size, 0);
+			this->_mapped = std::exchange(a_rhs._mapped, 0);
+			this->_reserved = std::exchange(a_rhs._reserved, 0);
+#if !MMIO_OS_WINDOWS
+			this->_watch = std::exchange(a_rhs._watch, -1);
+#endif
+		}
+
+		[[nodiscard]] bool do_open(const std::filesystem::path::value_type* a_path) noexcept;
+		[[nodiscard]] bool do_refresh() noexcept;
+
+		native_handle_type _handle;
+		std::size_t _size{ 0 };
+		std::size_t _mapped{ 0 };
+		std::size_t _reserved{ 0 };
+#if !MMIO_OS_WINDOWS
+		int _watch{ -1 };  // inotify instance, or -1 to fall back to polling
+#endif
+	};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	struct hash_options final
+	{
+		// how many threads may hash at once, where 0 means one per hardware thread
+		std::size_t threads{ 0 };
+	};
+
+	// CRC-32C (Castagnoli), using the SSE4.2/ARMv8 crc instructions when the cpu has them.
+	// Passing a previous result as a_crc continues it, so crc32c(b, crc32c(a)) == crc32c(a + b).
+	[[nodiscard]] auto crc32c(
+		const void* a_data,
+		std::size_t a_size,
+		std::uint32_t a_crc = 0) noexcept
+		-> std::uint32_t;
+
+	// the crc of a + b, given crc32c(a), crc32c(b), and the size of b
+	[[nodiscard]] auto crc32c_combine(
+		std::uint32_t a_first,
+		std::uint32_t a_second,
+		std::size_t a_secondSize) noexcept
+		-> std::uint32_t;
+
+	// Hashes the mapping in parallel, with the same result as hashing it all at once.
+	// A lazy file is mapped first, and one which fails to map hashes as if it were empty.
+	template <mapmode MODE>
+	[[nodiscard]] auto crc32c(
+		const mapped_file<MODE>& a_file,
+		const hash_options& a_options = {}) noexcept
+		-> std::uint32_t;
+
+	// XXH64, compatible with the reference implementation
+	[[nodiscard]] auto xxh64(
+		const void* a_data,
+		std::size_t a_size,
+		std::uint64_t a_seed = 0) noexcept
+		-> std::uint64_t;
+
+	// A 64-bit content hash for deduplication, computed in parallel.
+	// The input is split into fixed size leaves, each hashed with XXH64, and the leaf hashes are then hashed together,
+	// so the result only depends on the contents, and never on the number of threads. It does *not* match xxh64().
+	[[nodiscard]] auto content_hash(
+		const void* a_data,
+		std::size_t a_size,
+		const hash_options& a_options = {}) noexcept
+		-> std::uint64_t;
+
+	// maps a lazy file first, the same as crc32c()
+	template <mapmode MODE>
+	[[nodiscard]] auto content_hash(
+		const mapped_file<MODE>& a_file,
+		const hash_options& a_options = {}) noexcept
+		-> std::uint64_t;
+
+	class crc32c_hasher final
+	{
+	public:
+		[[nodiscard]] auto digest() const noexcept -> std::uint32_t { return this->_crc; }
+		void reset() noexcept { this->_crc = 0; }
+		void update(const void* a_data, std::size_t a_size) noexcept { this->_crc = crc32c(a_data, a_size, this->_crc); }
+
+	private:
+		std::uint32_t _crc{ 0 };
+	};
+
+	class xxh64_hasher final
+	{
+	public:
+		xxh64_hasher() noexcept { this->reset(); }
+		explicit xxh64_hasher(std::uint64_t a_seed) noexcept { this->reset(a_seed); }
+
+		[[nodiscard]] auto digest() const noexcept -> std::uint64_t;
+		void reset(std::uint64_t a_seed = 0) noexcept;
+		void update(const void* a_data, std::size_t a_size) noexcept;
+
+	private:
+		std::uint64_t _accumulators[4];
+		std::uint64_t _seed;
+		std::uint64_t _total;
+		std::byte _buffer[32];
+		std::size_t _buffered;
+	};
+
+	extern template auto crc32c(const mapped_file<mapmode::readonly>&, const hash_options&) noexcept -> std::uint32_t;
+	extern template auto crc32c(const mapped_file<mapmode::readwrite>&, const hash_options&) noexcept -> std::uint32_t;
+	extern template auto content_hash(const mapped_file<mapmode::readonly>&, const hash_options&) noexcept -> std::uint64_t;
+	extern template auto content_hash(const mapped_file<mapmode::readwrite>&, const hash_options&) noexcept -> std::uint64_t;
+}
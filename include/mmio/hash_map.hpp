@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	namespace detail
+	{
+		struct hash_map_layout final
+		{
+			std::uint32_t key_size{ 0 };
+			std::uint32_t value_size{ 0 };
+			std::uint32_t value_offset{ 0 };
+			std::uint32_t entry_size{ 0 };
+		};
+
+		// where the table lives within its mapping, stored as offsets so it survives the mapping being moved
+		struct hash_map_view final
+		{
+			std::uint64_t group_mask{ 0 };
+			std::uint64_t size{ 0 };
+			std::size_t entries_offset{ 0 };
+			hash_map_layout layout;
+		};
+
+		template <class K, class V>
+		[[nodiscard]] constexpr auto make_hash_map_layout() noexcept
+			-> hash_map_layout
+		{
+			constexpr auto align = alignof(K) > alignof(V) ? alignof(K) : alignof(V);
+			constexpr auto valueOffset = (sizeof(K) + alignof(V) - 1) / alignof(V) * alignof(V);
+			constexpr auto entrySize = (valueOffset + sizeof(V) + align - 1) / align * align;
+			return {
+				static_cast<std::uint32_t>(sizeof(K)),
+				static_cast<std::uint32_t>(sizeof(V)),
+				static_cast<std::uint32_t>(valueOffset),
+				static_cast<std::uint32_t>(entrySize)
+			};
+		}
+
+		[[nodiscard]] auto open_hash_map(
+			const mapped_file_source& a_file,
+			const hash_map_layout& a_layout,
+			hash_map_view& a_view) noexcept
+			-> std::error_code;
+
+		// returns the matching entry, or nullptr
+		[[nodiscard]] auto find_hash_map(
+			const std::byte* a_base,
+			const hash_map_view& a_view,
+			const void* a_key) noexcept
+			-> const std::byte*;
+
+		[[nodiscard]] auto write_hash_map(
+			const std::filesystem::path& a_path,
+			const hash_map_layout& a_layout,
+			const std::byte* a_entries,
+			std::size_t a_count) noexcept
+			-> std::error_code;
+	}
+
+	// A read-only key -> value table, looked up directly in the mapping without being deserialized.
+	// Entries are bucketed into groups of 16, each with a 16 byte array of tags which is probed with SSE2 where available.
+	// Keys are hashed by their object representation, so they must not contain padding, and the file is only
+	// readable on machines with the same endianness and type layout as the one which built it.
+	template <class K, class V>
+	class mapped_hash_map final
+	{
+	public:
+		static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>);
+		static_assert(std::has_unique_object_representations_v<K>, "keys are compared bytewise");
+
+		using key_type = K;
+		using mapped_type = V;
+		using size_type = std::size_t;
+
+		mapped_hash_map() noexcept = default;
+		mapped_hash_map(const mapped_hash_map&) = delete;
+		mapped_hash_map(mapped_hash_map&& a_rhs) noexcept { this->do_move(std::move(a_rhs)); }
+
+		explicit mapped_hash_map(std::filesystem::path a_path)
+		{
+			auto result = this->open(std::move(a_path));
+			if (!result) {
+				throw std::system_error{ *result };
+			}
+		}
+
+		~mapped_hash_map() noexcept = default;
+
+		mapped_hash_map& operator=(const mapped_hash_map&) = delete;
+		mapped_hash_map& operator=(mapped_hash_map&& a_rhs) noexcept
+		{
+			if (this != &a_rhs) {
+				this->close();
+				this->do_move(std::move(a_rhs));
+			}
+			return *this;
+		}
+
+		void close() noexcept
+		{
+			this->_file.close();
+			this->_view = {};
+		}
+
+		[[nodiscard]] bool contains(const key_type& a_key) const noexcept { return this->find(a_key) != nullptr; }
+		[[nodiscard]] bool empty() const noexcept { return this->size() == 0; }
+
+		// the returned pointer is valid for as long as the map stays open
+		[[nodiscard]] auto find(const key_type& a_key) const noexcept
+			-> const mapped_type*
+		{
+			const auto entry = detail::find_hash_map(this->_file.data(), this->_view, &a_key);
+			return entry != nullptr ?
+			           reinterpret_cast<const mapped_type*>(entry + this->_view.layout.value_offset) :
+			           nullptr;
+		}
+
+		[[nodiscard]] bool is_open() const noexcept { return this->_file.is_open(); }
+
+		auto open(std::filesystem::path a_path) noexcept
+			-> open_result
+		{
+			this->close();
+			if (auto result = this->_file.open(std::move(a_path)); !result) {
+				return result;
+			}
+
+			const auto error = detail::open_hash_map(this->_file, detail::make_hash_map_layout<K, V>(), this->_view);
+			if (error) {
+				this->close();
+			}
+			return { error };
+		}
+
+		[[nodiscard]] auto size() const noexcept -> size_type { return static_cast<size_type>(this->_view.size); }
+
+	private:
+		void do_move(mapped_hash_map&& a_rhs) noexcept
+		{
+			this->_file = std::move(a_rhs._file);
+			this->_view = std::exchange(a_rhs._view, {});
+		}
+
+		mapped_file_source _file;
+		detail::hash_map_view _view;
+	};
+
+	// Collects entries in memory, then writes them out as a file for mapped_hash_map.
+	template <class K, class V>
+	class mapped_hash_map_builder final
+	{
+	public:
+		static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>);
+		static_assert(std::has_unique_object_representations_v<K>, "keys are compared bytewise");
+
+		using key_type = K;
+		using mapped_type = V;
+		using size_type = std::size_t;
+
+		void clear() noexcept { this->_entries.clear(); }
+
+		// inserting a key more than once keeps the last value
+		void insert(const key_type& a_key, const mapped_type& a_value)
+		{
+			const auto offset = this->_entries.size();
+			this->_entries.resize(offset + layout.entry_size);
+			std::memcpy(this->_entries.data() + offset, &a_key, sizeof(key_type));
+			std::memcpy(this->_entries.data() + offset + layout.value_offset, &a_value, sizeof(mapped_type));
+		}
+
+		void reserve(size_type a_count) { this->_entries.reserve(a_count * layout.entry_size); }
+
+		// the number of insertions, including those which repeat a key
+		[[nodiscard]] auto size() const noexcept -> size_type { return this->_entries.size() / layout.entry_size; }
+
+		// The table is written to a temporary file next to a_path, flushed to disk, and then renamed over it,
+		// so readers in other processes always see either the old table or the new one, never a partial write.
+		// Readers which already have the old table open keep using it until they reopen. Windows can't replace
+		// a file which is still mapped, so there, writing fails until every reader of the old table has closed it.
+		auto write(const std::filesystem::path& a_path) const noexcept
+			-> open_result
+		{
+			return { detail::write_hash_map(a_path, layout, this->_entries.data(), this->size()) };
+		}
+
+	private:
+		static constexpr auto layout = detail::make_hash_map_layout<K, V>();
+
+		std::vector<std::byte> _entries;
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
@@ -20,11 +21,23 @@
 
 namespace mmio
 {
+	enum class loadmode;
 	enum class mapmode;
 	struct native_handle_type;
 	class open_result;
+	class transfer_result;
 	template <mapmode>
 	class mapped_file;
+	class mapped_file_follower;
+	class mapped_file_update;
+	template <class, class>
+	class mapped_hash_map;
+	template <class, class>
+	class mapped_hash_map_builder;
+	class partitioned_writer;
+	class record_index;
+	class seqlock_sink;
+	class seqlock_source;
 
 	enum class mapmode
 	{
@@ -32,6 +45,14 @@ namespace mmio
 		readwrite
 	};
 
+	enum class loadmode
+	{
+		// the file is mapped as soon as it is opened
+		eager,
+		// the file is only opened, and mapped on the first call to `map()`/`begin()`/`end()`
+		lazy
+	};
+
 	constexpr auto dynamic_size = static_cast<std::size_t>(-1);
 
 #if MMIO_OS_WINDOWS
@@ -53,6 +74,14 @@ namespace mmio
 	};
 #endif
 
+#if MMIO_OS_WINDOWS
+	using native_file_type = void*;  // HANDLE
+	using native_socket_type = std::uintptr_t;  // SOCKET
+#else
+	using native_file_type = int;
+	using native_socket_type = int;
+#endif
+
 	class open_result final
 	{
 	public:
@@ -67,6 +96,16 @@ namespace mmio
 	private:
 		template <mapmode>
 		friend class mapped_file;
+		friend class mapped_file_follower;
+		friend class mapped_file_update;
+		template <class, class>
+		friend class mapped_hash_map;
+		template <class, class>
+		friend class mapped_hash_map_builder;
+		friend class partitioned_writer;
+		friend class record_index;
+		friend class seqlock_sink;
+		friend class seqlock_source;
 
 		open_result(value_type a_error) noexcept :
 			_error(std::move(a_error))
@@ -75,6 +114,33 @@ namespace mmio
 		value_type _error;
 	};
 
+	class transfer_result final
+	{
+	public:
+		using value_type = std::error_code;
+
+		transfer_result() = delete;
+
+		[[nodiscard]] explicit operator bool() const noexcept { return this->_error.value() == 0; }
+		[[nodiscard]] const value_type& operator*() const noexcept { return this->_error; }
+		[[nodiscard]] const value_type* operator->() const noexcept { return &this->_error; }
+
+		// the number of bytes which made it to the destination, even if an error occurred midway
+		[[nodiscard]] auto transferred() const noexcept -> std::size_t { return this->_transferred; }
+
+	private:
+		template <mapmode>
+		friend class mapped_file;
+
+		transfer_result(value_type a_error, std::size_t a_transferred) noexcept :
+			_error(std::move(a_error)),
+			_transferred(a_transferred)
+		{}
+
+		value_type _error;
+		std::size_t _transferred{ 0 };
+	};
+
 	template <mapmode MODE>
 	class mapped_file final :
 		public std::enable_shared_from_this<mapped_file<MODE>>
@@ -91,7 +157,10 @@ namespace mmio
 		mapped_file() noexcept = default;
 		mapped_file(const mapped_file&) = delete;
 		mapped_file(mapped_file&& a_rhs) noexcept { this->do_move(std::move(a_rhs)); }
-		mapped_file(std::filesystem::path a_path, std::size_t a_size = dynamic_size);
+		mapped_file(
+			std::filesystem::path a_path,
+			std::size_t a_size = dynamic_size,
+			loadmode a_load = loadmode::eager);
 
 		~mapped_file() noexcept { this->close(); }
 
@@ -104,40 +173,123 @@ namespace mmio
 			return *this;
 		}
 
-		[[nodiscard]] auto begin() const noexcept -> iterator { return this->data(); }
-		[[nodiscard]] auto end() const noexcept -> iterator { return this->data() + this->size(); }
+		// these map a lazy file, like `map()`, and are both nullptr if that fails
+		[[nodiscard]] auto begin() const noexcept -> iterator { return this->map(); }
+		[[nodiscard]] auto end() const noexcept
+			-> iterator
+		{
+			const auto data = this->map();
+			return data != nullptr ? data + this->size() : data;
+		}
 
 		void close() noexcept;
-		[[nodiscard]] auto data() const noexcept -> value_type*;
+
+		// Writes [a_offset, a_offset + a_length) of the mapping to the file's current position.
+		// On linux, `copy_file_range`, then `sendfile` move the data without touching the mapped pages, falling back to `write`.
+		// Windows has no file to file equivalent, so `WriteFile` copies from the mapped view through user space.
+		auto copy_to(
+			native_file_type a_file,
+			std::size_t a_offset,
+			std::size_t a_length) const noexcept
+			-> transfer_result;
+
+		// A plain load, so it costs nothing to call on every iteration of a loop.
+		// With `loadmode::lazy`, this is nullptr until `map()`, `begin()` or `end()` has been called.
+		[[nodiscard]] auto data() const noexcept -> value_type* { return this->_data; }
+
 		[[nodiscard]] bool empty() const noexcept { return this->size() == 0; }
-		[[nodiscard]] bool is_open() const noexcept;
 
+		// an eager file is open exactly when it is mapped, and a lazy file goes back to eager when closed
+		[[nodiscard]] bool is_open() const noexcept
+		{
+			return this->_load == loadmode::lazy ||
+			       this->_data != nullptr;
+		}
+
+		[[nodiscard]] auto load_mode() const noexcept -> loadmode { return this->_load; }
+
+		// with `loadmode::lazy`, the handle has no mapping until `map()`, `begin()` or `end()` has been called
 		[[nodiscard]] auto native_handle() const noexcept
 			-> const native_handle_type&
 		{
 			return this->_handle;
 		}
 
+		// Maps the file if it isn't already, and returns what `data()` will from then on, or nullptr if the mapping failed.
+		// This is safe to call from multiple threads at once, and only the first call takes a lock. Threads which may race
+		// with the first call must use its result, or call `data()` only after it has returned.
+		auto map() const noexcept -> value_type*;
+
 		auto open(
 			std::filesystem::path a_path,
-			std::size_t a_size = dynamic_size) noexcept
+			std::size_t a_size = dynamic_size,
+			loadmode a_load = loadmode::eager) noexcept
 			-> open_result;
 
+		// Sends [a_offset, a_offset + a_length) of the mapping over the socket.
+		// Uses `sendfile` on linux, and `TransmitFile` on windows, both of which read from the file cache without
+		// touching the mapped pages, falling back to copying from the mapping with `send`.
+		auto send_to(
+			native_socket_type a_socket,
+			std::size_t a_offset,
+			std::size_t a_length) const noexcept
+			-> transfer_result;
+
 		[[nodiscard]] auto size() const noexcept -> std::size_t { return this->_size; }
 
+		// Drops the mapping while keeping the file open, switching to `loadmode::lazy`,
+		// so the next `map()`/`begin()`/`end()` maps it again.
+		// Any pointers into the mapping are invalidated, so this must not race with their use.
+		void unmap_idle() noexcept;
+
 	private:
+		friend class mapped_file_update;
+		friend class seqlock_sink;
+		friend class seqlock_source;
+
+		// how an open treats a file which is already there, for the formats built on top of this which need more than `open()`
+		enum class openmode
+		{
+			// what `open()` does, where sinks start out empty on windows
+			standard,
+			// the file must already exist, and keeps its contents
+			existing,
+			// sinks keep the contents of an existing file, and both ends can be open at once in different processes
+			shared
+		};
+
 		void do_move(mapped_file&& a_rhs) noexcept
 		{
-			this->_handle = std::exchange(a_rhs._handle, native_handle_type{});
+			this->_data = std::exchange(a_rhs._data, nullptr);
 			this->_size = std::exchange(a_rhs._size, 0);
+			this->_handle = std::exchange(a_rhs._handle, native_handle_type{});
+			this->_load = std::exchange(a_rhs._load, loadmode::eager);
+			this->_mapped.store(a_rhs._mapped.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
 		}
 
+		[[nodiscard]] bool do_map() const noexcept;
+
 		[[nodiscard]] bool do_open(
 			const std::filesystem::path::value_type* a_path,
-			std::size_t a_size) noexcept;
+			std::size_t a_size,
+			openmode a_mode) noexcept;
+
+		auto do_open(
+			std::filesystem::path a_path,
+			std::size_t a_size,
+			loadmode a_load,
+			openmode a_mode) noexcept
+			-> open_result;
+
+		void do_unmap() const noexcept;
 
-		native_handle_type _handle;
+		// The base address and size are cached here so the hot accessors can be inlined without knowing
+		// how the platform represents a failed mapping. Lazily mapped files fill in the mapping from `map()`.
+		mutable value_type* _data{ nullptr };
+		mutable std::atomic<value_type*> _mapped{ nullptr };  // `_data`, published for lazy first access
 		std::size_t _size{ 0 };
+		mutable native_handle_type _handle;
+		loadmode _load{ loadmode::eager };
 	};
 
 	extern template class mapped_file<mapmode::readonly>;
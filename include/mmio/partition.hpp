@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	struct write_partition final
+	{
+		[[nodiscard]] explicit operator bool() const noexcept { return this->data != nullptr; }
+
+		[[nodiscard]] auto begin() const noexcept -> std::byte* { return this->data; }
+		[[nodiscard]] auto end() const noexcept -> std::byte* { return this->data + this->size; }
+
+		std::byte* data{ nullptr };
+		std::size_t offset{ 0 };
+		std::size_t size{ 0 };
+		std::size_t index{ 0 };
+	};
+
+	// Splits a sink into page aligned partitions, for many threads to fill at once.
+	// Each thread claims partitions with `next_partition()`, and hands them to `flush()` once they're written,
+	// which starts writing them back to disk while the other threads keep going. `finish()` then only has to
+	// wait on whatever is still in flight, behind a single barrier, rather than sync the whole file by itself.
+	// The sink must stay open, and must not be remapped, for as long as the writer is in use.
+	class partitioned_writer final
+	{
+	public:
+		// A lazy sink is mapped up front, and one which fails to map has no partitions.
+		// a_partitionSize is rounded up to a multiple of the page size.
+		partitioned_writer(mapped_file_sink& a_file, std::size_t a_partitionSize) noexcept;
+		partitioned_writer(const partitioned_writer&) = delete;
+		partitioned_writer(partitioned_writer&&) = delete;
+
+		~partitioned_writer() noexcept = default;
+
+		partitioned_writer& operator=(const partitioned_writer&) = delete;
+		partitioned_writer& operator=(partitioned_writer&&) = delete;
+
+		// Blocks until everything written so far is durable (`fdatasync`/`FlushFileBuffers`).
+		// Partitions which were never flushed are included, so calling `flush()` is an optimization, not a requirement.
+		auto finish() noexcept -> open_result;
+
+		// Starts writing back a partition without waiting for it to reach the disk (`sync_file_range` on linux,
+		// `FlushViewOfFile` on windows). The partition must not be written to afterwards, or those writes may be missed.
+		auto flush(const write_partition& a_partition) noexcept -> open_result;
+
+		// claims the next unwritten partition, returning an empty one once they have all been handed out
+		[[nodiscard]] auto next_partition() noexcept -> write_partition;
+
+		[[nodiscard]] auto partition_count() const noexcept -> std::size_t { return this->_partitionCount; }
+		[[nodiscard]] auto partition_size() const noexcept -> std::size_t { return this->_partitionSize; }
+
+	private:
+		mapped_file_sink* _file;
+		std::size_t _partitionSize;
+		std::size_t _partitionCount;
+		std::atomic_size_t _next{ 0 };
+	};
+}
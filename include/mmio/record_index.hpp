@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	enum class record_format : std::uint32_t
+	{
+		// records are terminated by `delimiter`, a trailing unterminated record is still counted
+		delimited,
+		// records are a little-endian `std::uint32_t` length followed by that many bytes
+		length_prefixed
+	};
+
+	struct record_index_options final
+	{
+		record_format format{ record_format::delimited };
+		std::byte delimiter{ '\n' };
+		// store the offset of every nth record, trading lookup time for sidecar size
+		std::uint32_t sample_interval{ 1 };
+	};
+
+	struct record_extent final
+	{
+		std::size_t offset{ 0 };
+		std::size_t size{ 0 };
+	};
+
+	// Maps a source file together with a sidecar file of record offsets.
+	// The sidecar is validated against the source's size and last write time when opened/refreshed:
+	// a matching sidecar is used as-is, a source which has grown is assumed to have been appended to
+	// and only the new bytes are scanned, and anything else causes the sidecar to be rebuilt.
+	// Sidecars are replaced with a rename, so other indexes with the old one open keep using it. Windows can't replace
+	// a file which is still mapped, so there, updating a sidecar fails until every other index using it is closed.
+	class record_index final
+	{
+	public:
+		record_index() noexcept = default;
+		record_index(const record_index&) = delete;
+		record_index(record_index&&) noexcept = default;
+		record_index(
+			std::filesystem::path a_source,
+			std::filesystem::path a_index,
+			record_index_options a_options = {});
+
+		~record_index() noexcept = default;
+
+		record_index& operator=(const record_index&) = delete;
+		record_index& operator=(record_index&&) noexcept = default;
+
+		// the extent of the record's payload, excluding its delimiter/length prefix
+		[[nodiscard]] auto operator[](std::size_t a_record) const noexcept -> record_extent { return this->record(a_record); }
+
+		void close() noexcept;
+		[[nodiscard]] bool empty() const noexcept { return this->size() == 0; }
+		[[nodiscard]] bool is_open() const noexcept { return this->_index.is_open(); }
+
+		// the offset of the record's first byte, including its length prefix
+		[[nodiscard]] auto offset(std::size_t a_record) const noexcept -> std::size_t;
+
+		auto open(
+			std::filesystem::path a_source,
+			std::filesystem::path a_index,
+			record_index_options a_options = {}) noexcept
+			-> open_result;
+
+		[[nodiscard]] auto options() const noexcept -> const record_index_options& { return this->_options; }
+		[[nodiscard]] auto record(std::size_t a_record) const noexcept -> record_extent;
+
+		// Picks up any bytes appended to the source since the index was opened/last refreshed.
+		// On windows, this fails if the sidecar needs updating while another index has it open.
+		auto refresh() noexcept -> open_result;
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t;
+		[[nodiscard]] auto source() const noexcept -> const mapped_file_source& { return this->_source; }
+
+	private:
+		[[nodiscard]] auto do_refresh() noexcept -> std::error_code;
+
+		std::filesystem::path _sourcePath;
+		std::filesystem::path _indexPath;
+		record_index_options _options;
+		mapped_file_source _source;
+		mapped_file_source _index;
+	};
+}
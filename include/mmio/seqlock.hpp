@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	// Publishes a fixed size payload through a mapped file, for one writer and any number of reader processes.
+	// The file holds two slots, each guarded by its own sequence counter, and a version selecting the current slot.
+	// The writer fills the slot readers are *not* using, then flips the version, so readers never block, and
+	// only retry when the writer publishes twice while they are still copying.
+	// Publishing from more than one sink at a time is not supported, and must be coordinated externally.
+	class seqlock_sink final
+	{
+	public:
+		seqlock_sink() noexcept = default;
+		seqlock_sink(const seqlock_sink&) = delete;
+		seqlock_sink(seqlock_sink&&) noexcept = default;
+		seqlock_sink(std::filesystem::path a_path, std::size_t a_payloadSize);
+
+		~seqlock_sink() noexcept = default;
+
+		seqlock_sink& operator=(const seqlock_sink&) = delete;
+		seqlock_sink& operator=(seqlock_sink&&) noexcept = default;
+
+		void close() noexcept { this->_file.close(); }
+		[[nodiscard]] bool is_open() const noexcept { return this->_file.is_open(); }
+
+		// an existing file with the same payload size keeps its contents and version
+		auto open(
+			std::filesystem::path a_path,
+			std::size_t a_payloadSize) noexcept
+			-> open_result;
+
+		[[nodiscard]] auto payload_size() const noexcept -> std::size_t { return this->_payloadSize; }
+
+		// returns the version readers will observe alongside this payload
+		auto publish(const void* a_payload, std::size_t a_size) noexcept -> std::uint32_t;
+
+		template <class T>
+		auto publish(const T& a_payload) noexcept
+			-> std::uint32_t
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			return this->publish(&a_payload, sizeof(T));
+		}
+
+		[[nodiscard]] auto version() const noexcept -> std::uint32_t;
+
+	private:
+		mapped_file_sink _file;
+		std::size_t _payloadSize{ 0 };
+	};
+
+	class seqlock_source final
+	{
+	public:
+		seqlock_source() noexcept = default;
+		seqlock_source(const seqlock_source&) = delete;
+		seqlock_source(seqlock_source&&) noexcept = default;
+		explicit seqlock_source(std::filesystem::path a_path);
+
+		~seqlock_source() noexcept = default;
+
+		seqlock_source& operator=(const seqlock_source&) = delete;
+		seqlock_source& operator=(seqlock_source&&) noexcept = default;
+
+		void close() noexcept { this->_file.close(); }
+		[[nodiscard]] bool is_open() const noexcept { return this->_file.is_open(); }
+		auto open(std::filesystem::path a_path) noexcept -> open_result;
+		[[nodiscard]] auto payload_size() const noexcept -> std::size_t { return this->_payloadSize; }
+
+		// copies a consistent snapshot of the payload into a_payload, and returns its version
+		auto read(void* a_payload, std::size_t a_size) const noexcept -> std::uint32_t;
+
+		template <class T>
+		[[nodiscard]] auto read() const noexcept
+			-> T
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T result;
+			this->read(&result, sizeof(T));
+			return result;
+		}
+
+		// cheap enough to poll, to see if there is anything new to read
+		[[nodiscard]] auto version() const noexcept -> std::uint32_t;
+
+	private:
+		mapped_file_source _file;
+		std::size_t _payloadSize{ 0 };
+	};
+}
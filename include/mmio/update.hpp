@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+#include "mmio/mmio.hpp"
+
+namespace mmio
+{
+	// Edits a private copy of a file, then atomically swaps it in for the original.
+	// The copy is made with a reflink (`FICLONE`) where the filesystem supports them, falling back to `copy_file_range`
+	// on linux, and `CopyFileW` on windows, so on copy-on-write filesystems an update only costs the extents it touches.
+	// Readers which have the original mapped keep seeing it, unchanged, until they reopen the path.
+	// Windows can't replace a file which is still mapped, so there, committing fails until every reader
+	// has closed the original.
+	class mapped_file_update final
+	{
+	public:
+		using value_type = std::byte;
+		using iterator = value_type*;
+
+		mapped_file_update() noexcept = default;
+		mapped_file_update(const mapped_file_update&) = delete;
+		mapped_file_update(mapped_file_update&& a_rhs) noexcept { this->do_move(std::move(a_rhs)); }
+		explicit mapped_file_update(
+			std::filesystem::path a_path,
+			std::size_t a_size = dynamic_size);
+
+		// an update which was never committed is discarded
+		~mapped_file_update() noexcept { this->abort(); }
+
+		mapped_file_update& operator=(const mapped_file_update&) = delete;
+		mapped_file_update& operator=(mapped_file_update&& a_rhs) noexcept
+		{
+			if (this != &a_rhs) {
+				this->abort();
+				this->do_move(std::move(a_rhs));
+			}
+			return *this;
+		}
+
+		[[nodiscard]] auto begin() const noexcept -> iterator { return this->data(); }
+		[[nodiscard]] auto end() const noexcept -> iterator { return this->data() + this->size(); }
+
+		// closes and deletes the working copy, leaving the original untouched
+		void abort() noexcept;
+
+		// Copies a_path to a temporary file next to it, and maps the copy for writing.
+		// A size other than `dynamic_size` resizes the copy before it is mapped.
+		// Empty files can't be mapped, so an empty original, or a size of 0, fails with `invalid_argument`
+		// before anything is copied. Pass a size to grow an empty original instead.
+		auto begin_update(
+			std::filesystem::path a_path,
+			std::size_t a_size = dynamic_size) noexcept
+			-> open_result;
+
+		// Flushes the working copy to disk, renames it over the original, then flushes the directory entry.
+		// The update is closed afterwards, whether it succeeded or not. If flushing or renaming fails, the original is left
+		// as it was. If only flushing the directory fails, the original has already been replaced, but the rename
+		// may not survive a crash.
+		auto commit() noexcept -> open_result;
+
+		[[nodiscard]] auto data() const noexcept -> value_type* { return this->_file.data(); }
+		[[nodiscard]] bool empty() const noexcept { return this->size() == 0; }
+		[[nodiscard]] bool is_open() const noexcept { return this->_file.is_open(); }
+		[[nodiscard]] auto native_handle() const noexcept -> const native_handle_type& { return this->_file.native_handle(); }
+		[[nodiscard]] auto path() const noexcept -> const std::filesystem::path& { return this->_path; }
+		[[nodiscard]] auto size() const noexcept -> std::size_t { return this->_file.size(); }
+
+	private:
+		void do_move(mapped_file_update&& a_rhs) noexcept
+		{
+			this->_file = std::move(a_rhs._file);
+			this->_path = std::exchange(a_rhs._path, {});
+			this->_temporary = std::exchange(a_rhs._temporary, {});
+		}
+
+		mapped_file_sink _file;
+		std::filesystem::path _path;
+		std::filesystem::path _temporary;
+	};
+}
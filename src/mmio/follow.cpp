@@ -0,0 +1,330 @@
+#include "mmio/follow.hpp"
+#include "mmio/os.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if !MMIO_OS_WINDOWS
+#	include <poll.h>
+#	include <sys/inotify.h>
+#endif
+
+namespace mmio
+{
+	namespace
+	{
+		// how often to check the file's size when change notifications are not available
+		constexpr std::chrono::milliseconds poll_interval{ 10 };
+
+		[[nodiscard]] constexpr auto round_up(std::size_t a_value, std::size_t a_alignment) noexcept
+			-> std::size_t
+		{
+			return (a_value + a_alignment - 1) / a_alignment * a_alignment;
+		}
+	}
+
+	mapped_file_follower::mapped_file_follower(
+		std::filesystem::path a_path,
+		std::size_t a_reserve)
+	{
+		auto result = this->open(std::move(a_path), a_reserve);
+		if (!result) {
+			throw std::system_error{ *result };
+		}
+	}
+
+	void mapped_file_follower::close() noexcept
+	{
+#if MMIO_OS_WINDOWS
+		if (this->_handle.base_address != nullptr) {
+			[[maybe_unused]] const auto success = ::UnmapViewOfFile(this->_handle.base_address);
+			assert(success != 0);
+			this->_handle.base_address = nullptr;
+		}
+
+		if (this->_handle.file_mapping_object != nullptr) {
+			[[maybe_unused]] const auto success = ::CloseHandle(this->_handle.file_mapping_object);
+			assert(success != 0);
+			this->_handle.file_mapping_object = nullptr;
+		}
+
+		if (this->_handle.file != INVALID_HANDLE_VALUE) {
+			[[maybe_unused]] const auto success = ::CloseHandle(this->_handle.file);
+			assert(success != 0);
+			this->_handle.file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (this->_watch != -1) {
+			[[maybe_unused]] const auto success = ::close(this->_watch);
+			assert(success == 0);
+			this->_watch = -1;
+		}
+
+		if (this->_handle.addr != MAP_FAILED) {
+			[[maybe_unused]] const auto success = ::munmap(this->_handle.addr, this->_reserved);
+			assert(success == 0);
+			this->_handle.addr = MAP_FAILED;
+		}
+
+		if (this->_handle.fd != -1) {
+			[[maybe_unused]] const auto success = ::close(this->_handle.fd);
+			assert(success == 0);
+			this->_handle.fd = -1;
+		}
+#endif
+
+		this->_size = 0;
+		this->_mapped = 0;
+		this->_reserved = 0;
+	}
+
+	auto mapped_file_follower::data() const noexcept
+		-> value_type*
+	{
+#if MMIO_OS_WINDOWS
+		return static_cast<value_type*>(this->_handle.base_address);
+#else
+		return this->_handle.addr != MAP_FAILED ?
+		           static_cast<value_type*>(this->_handle.addr) :
+		           nullptr;
+#endif
+	}
+
+	bool mapped_file_follower::is_open() const noexcept
+	{
+#if MMIO_OS_WINDOWS
+		return this->_handle.file != INVALID_HANDLE_VALUE;
+#else
+		return this->_handle.addr != MAP_FAILED;
+#endif
+	}
+
+	auto mapped_file_follower::open(
+		std::filesystem::path a_path,
+		std::size_t a_reserve) noexcept
+		-> open_result
+	{
+		this->close();
+		this->_reserved = round_up((std::max)(a_reserve, std::size_t{ 1 }), detail::page_size());
+		if (this->do_open(a_path.c_str()) && this->do_refresh()) {
+			return { std::error_code() };
+		} else {
+			const auto error = detail::decode_os_error();
+			this->close();
+			return { std::make_error_code(error) };
+		}
+	}
+
+	auto mapped_file_follower::refresh() noexcept
+		-> open_result
+	{
+		if (!this->is_open()) {
+			return { std::make_error_code(std::errc::bad_file_descriptor) };
+		}
+
+		// a failure to grow leaves what is already mapped untouched
+		return { this->do_refresh() ?
+			         std::error_code() :
+			         std::make_error_code(detail::decode_os_error()) };
+	}
+
+	auto mapped_file_follower::wait(std::chrono::milliseconds a_timeout) noexcept
+		-> open_result
+	{
+		const auto deadline = std::chrono::steady_clock::now() + a_timeout;
+		const auto previous = this->_size;
+		for (;;) {
+			if (auto result = this->refresh(); !result) {
+				return result;
+			} else if (this->_size > previous) {
+				return result;
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			if (now >= deadline) {
+				return { std::make_error_code(std::errc::timed_out) };
+			}
+
+#if !MMIO_OS_WINDOWS
+			if (this->_watch != -1) {
+				const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+				::pollfd watch = { this->_watch, POLLIN, 0 };
+				(void)::poll(&watch, 1, static_cast<int>((std::min)(remaining, static_cast<std::chrono::milliseconds::rep>(INT_MAX))));
+
+				// the events only serve to wake us up, the size is what matters
+				alignas(::inotify_event) char events[4096];
+				while (::read(this->_watch, events, sizeof(events)) > 0) {}
+				continue;
+			}
+#endif
+
+			std::this_thread::sleep_for((std::min)(std::chrono::duration_cast<std::chrono::steady_clock::duration>(poll_interval), deadline - now));
+		}
+	}
+
+#if MMIO_OS_WINDOWS
+	bool mapped_file_follower::do_open(const wchar_t* a_path) noexcept
+	{
+		// the writer needs to keep appending while we hold the file open
+		this->_handle.file = ::CreateFileW(
+			a_path,
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+		return this->_handle.file != INVALID_HANDLE_VALUE;
+	}
+
+	bool mapped_file_follower::do_refresh() noexcept
+	{
+		::LARGE_INTEGER size = {};
+		if (::GetFileSizeEx(this->_handle.file, &size) == 0) {
+			return false;
+		}
+
+		const auto visible = static_cast<std::size_t>(size.QuadPart);
+		if (visible > this->_mapped) {
+			// views can not be grown in place, so map the file again at its new size,
+			// and only let go of the old view once the new one is in place
+			const auto mapping = ::CreateFileMappingW(
+				this->_handle.file,
+				nullptr,
+				PAGE_READONLY,
+				size.HighPart,
+				size.LowPart,
+				nullptr);
+			if (mapping == nullptr) {
+				return false;
+			}
+
+			const auto address = ::MapViewOfFile(
+				mapping,
+				FILE_MAP_READ,
+				0,
+				0,
+				0);
+			if (address == nullptr) {
+				const auto error = ::GetLastError();
+				[[maybe_unused]] const auto success = ::CloseHandle(mapping);
+				assert(success != 0);
+				::SetLastError(error);
+				return false;
+			}
+
+			if (this->_handle.base_address != nullptr) {
+				[[maybe_unused]] const auto success = ::UnmapViewOfFile(this->_handle.base_address);
+				assert(success != 0);
+			}
+
+			if (this->_handle.file_mapping_object != nullptr) {
+				[[maybe_unused]] const auto success = ::CloseHandle(this->_handle.file_mapping_object);
+				assert(success != 0);
+			}
+
+			this->_handle.file_mapping_object = mapping;
+			this->_handle.base_address = address;
+			this->_mapped = visible;
+		}
+
+		this->_size = (std::min)(visible, this->_mapped);
+		return true;
+	}
+#else
+	bool mapped_file_follower::do_open(const char* a_path) noexcept
+	{
+		this->_handle.fd = ::open(a_path, O_RDONLY);
+		if (this->_handle.fd == -1) {
+			return false;
+		}
+
+		this->_handle.addr = ::mmap(
+			nullptr,
+			this->_reserved,
+			PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			-1,
+			0);
+		if (this->_handle.addr == MAP_FAILED) {
+			return false;
+		}
+
+		// running out of inotify watches is not fatal, it just makes waiting less responsive
+		this->_watch = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (this->_watch != -1 &&
+			::inotify_add_watch(this->_watch, a_path, IN_MODIFY) == -1) {
+			[[maybe_unused]] const auto success = ::close(this->_watch);
+			assert(success == 0);
+			this->_watch = -1;
+		}
+
+		return true;
+	}
+
+	bool mapped_file_follower::do_refresh() noexcept
+	{
+		struct ::stat s = {};
+		if (::fstat(this->_handle.fd, &s) == -1) {
+			return false;
+		}
+
+		const auto visible = static_cast<std::size_t>(s.st_size);
+		const auto pageSize = detail::page_size();
+		const auto mapped = round_up(visible, pageSize);
+		if (visible > this->_reserved) {
+			// outgrew the reservation, so map everything into a bigger one, and only then let go of the old one
+			const auto reserve = (std::max)(this->_reserved * 2, mapped);
+			const auto addr = ::mmap(
+				nullptr,
+				reserve,
+				PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+				-1,
+				0);
+			if (addr == MAP_FAILED) {
+				return false;
+			}
+
+			if (::mmap(addr, mapped, PROT_READ, MAP_SHARED | MAP_FIXED, this->_handle.fd, 0) == MAP_FAILED) {
+				const auto error = errno;
+				[[maybe_unused]] const auto success = ::munmap(addr, reserve);
+				assert(success == 0);
+				errno = error;
+				return false;
+			}
+
+			[[maybe_unused]] const auto success = ::munmap(this->_handle.addr, this->_reserved);
+			assert(success == 0);
+			this->_handle.addr = addr;
+			this->_reserved = reserve;
+			this->_mapped = mapped;
+		}
+
+		if (mapped > this->_mapped) {
+			const auto addr = ::mmap(
+				static_cast<std::byte*>(this->_handle.addr) + this->_mapped,
+				mapped - this->_mapped,
+				PROT_READ,
+				MAP_SHARED | MAP_FIXED,
+				this->_handle.fd,
+				static_cast<::off_t>(this->_mapped));
+			if (addr == MAP_FAILED) {
+				return false;
+			}
+			this->_mapped = mapped;
+		}
+
+		// a truncated file can not be read past its end, even if those pages are still mapped
+		this->_size = visible;
+		return true;
+	}
+#endif
+}
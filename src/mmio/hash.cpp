@@ -0,0 +1,565 @@
+#include "mmio/hash.hpp"
+#include "mmio/os.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define MMIO_CRC32C_X86 true
+#	include <nmmintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#else
+#	define MMIO_CRC32C_X86 false
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#	define MMIO_CRC32C_ARM true
+#	include <arm_acle.h>
+#else
+#	define MMIO_CRC32C_ARM false
+#endif
+
+#if MMIO_CRC32C_X86 && (defined(__GNUC__) || defined(__clang__))
+#	define MMIO_TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+#	define MMIO_TARGET_SSE42
+#endif
+
+namespace mmio
+{
+	namespace
+	{
+		// large enough to amortize scheduling, small enough to balance across threads
+		constexpr std::size_t chunk_size = std::size_t{ 1 } << 20;
+
+		template <class T>
+		[[nodiscard]] auto load(const unsigned char* a_src) noexcept
+			-> T
+		{
+			T result;
+			std::memcpy(&result, a_src, sizeof(T));
+			return result;
+		}
+
+		namespace crc
+		{
+			constexpr std::uint32_t polynomial = 0x82F63B78;  // reflected
+
+			struct tables final
+			{
+				std::uint32_t data[8][256];
+			};
+
+			[[nodiscard]] constexpr auto make_tables() noexcept
+				-> tables
+			{
+				tables result{};
+				for (std::uint32_t i = 0; i < 256; ++i) {
+					auto c = i;
+					for (int k = 0; k < 8; ++k) {
+						c = (c & 1) != 0 ? (c >> 1) ^ polynomial : c >> 1;
+					}
+					result.data[0][i] = c;
+				}
+
+				for (std::uint32_t i = 0; i < 256; ++i) {
+					for (std::size_t k = 1; k < 8; ++k) {
+						const auto prev = result.data[k - 1][i];
+						result.data[k][i] = (prev >> 8) ^ result.data[0][prev & 0xFF];
+					}
+				}
+
+				return result;
+			}
+
+			constexpr auto table = make_tables();
+
+			// slicing-by-8, for cpus without crc instructions
+			[[nodiscard]] auto update_software(
+				std::uint32_t a_crc,
+				const unsigned char* a_data,
+				std::size_t a_size) noexcept
+				-> std::uint32_t
+			{
+				const auto& t = table.data;
+				for (; a_size >= 8; a_data += 8, a_size -= 8) {
+					const auto lo = load<std::uint32_t>(a_data) ^ a_crc;
+					const auto hi = load<std::uint32_t>(a_data + 4);
+					a_crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+					        t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+				}
+
+				for (; a_size > 0; ++a_data, --a_size) {
+					a_crc = t[0][(a_crc ^ *a_data) & 0xFF] ^ (a_crc >> 8);
+				}
+
+				return a_crc;
+			}
+
+#if MMIO_CRC32C_X86
+			MMIO_TARGET_SSE42 [[nodiscard]] auto update_sse42(
+				std::uint32_t a_crc,
+				const unsigned char* a_data,
+				std::size_t a_size) noexcept
+				-> std::uint32_t
+			{
+#	if defined(__x86_64__) || defined(_M_X64)
+				std::uint64_t wide = a_crc;
+				for (; a_size >= 8; a_data += 8, a_size -= 8) {
+					wide = _mm_crc32_u64(wide, load<std::uint64_t>(a_data));
+				}
+				a_crc = static_cast<std::uint32_t>(wide);
+#	endif
+				for (; a_size >= 4; a_data += 4, a_size -= 4) {
+					a_crc = _mm_crc32_u32(a_crc, load<std::uint32_t>(a_data));
+				}
+				for (; a_size > 0; ++a_data, --a_size) {
+					a_crc = _mm_crc32_u8(a_crc, *a_data);
+				}
+				return a_crc;
+			}
+
+			[[nodiscard]] bool has_sse42() noexcept
+			{
+#	ifdef _MSC_VER
+				int info[4] = {};
+				::__cpuid(info, 1);
+				return (info[2] & (1 << 20)) != 0;
+#	else
+				return __builtin_cpu_supports("sse4.2");
+#	endif
+			}
+#endif
+
+#if MMIO_CRC32C_ARM
+			[[nodiscard]] auto update_arm(
+				std::uint32_t a_crc,
+				const unsigned char* a_data,
+				std::size_t a_size) noexcept
+				-> std::uint32_t
+			{
+				for (; a_size >= 8; a_data += 8, a_size -= 8) {
+					a_crc = __crc32cd(a_crc, load<std::uint64_t>(a_data));
+				}
+				for (; a_size > 0; ++a_data, --a_size) {
+					a_crc = __crc32cb(a_crc, *a_data);
+				}
+				return a_crc;
+			}
+#endif
+
+			// operates on the raw register, without the pre/post inversion
+			[[nodiscard]] auto update(
+				std::uint32_t a_crc,
+				const unsigned char* a_data,
+				std::size_t a_size) noexcept
+				-> std::uint32_t
+			{
+#if MMIO_CRC32C_ARM
+				return update_arm(a_crc, a_data, a_size);
+#else
+#	if MMIO_CRC32C_X86
+				static const bool hardware = has_sse42();
+				if (hardware) {
+					return update_sse42(a_crc, a_data, a_size);
+				}
+#	endif
+				return update_software(a_crc, a_data, a_size);
+#endif
+			}
+
+			// (a * b) mod p, for polynomials over GF(2)
+			// https://github.com/madler/zlib/blob/04f42ceca40f73e2978b50e93806c2a18c1281fc/crc32.c#L545
+			[[nodiscard]] constexpr auto multmodp(std::uint32_t a_a, std::uint32_t a_b) noexcept
+				-> std::uint32_t
+			{
+				std::uint32_t m = std::uint32_t{ 1 } << 31;
+				std::uint32_t p = 0;
+				for (;;) {
+					if ((a_a & m) != 0) {
+						p ^= a_b;
+						if ((a_a & (m - 1)) == 0) {
+							break;
+						}
+					}
+					m >>= 1;
+					a_b = (a_b & 1) != 0 ? (a_b >> 1) ^ polynomial : a_b >> 1;
+				}
+				return p;
+			}
+
+			struct powers final
+			{
+				std::uint32_t data[32];
+			};
+
+			// x^(2^n) mod p
+			[[nodiscard]] constexpr auto make_powers() noexcept
+				-> powers
+			{
+				powers result{};
+				std::uint32_t p = std::uint32_t{ 1 } << 30;  // x^1
+				result.data[0] = p;
+				for (std::size_t n = 1; n < 32; ++n) {
+					p = multmodp(p, p);
+					result.data[n] = p;
+				}
+				return result;
+			}
+
+			constexpr auto x2n_table = make_powers();
+
+			// x^(n * 2^k) mod p
+			[[nodiscard]] constexpr auto x2nmodp(std::size_t a_n, std::size_t a_k) noexcept
+				-> std::uint32_t
+			{
+				std::uint32_t p = std::uint32_t{ 1 } << 31;  // x^0
+				for (; a_n != 0; a_n >>= 1, ++a_k) {
+					if ((a_n & 1) != 0) {
+						p = multmodp(x2n_table.data[a_k & 31], p);
+					}
+				}
+				return p;
+			}
+		}
+
+		namespace xxh
+		{
+			constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87;
+			constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+			constexpr std::uint64_t prime3 = 0x165667B19E3779F9;
+			constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63;
+			constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5;
+
+			[[nodiscard]] constexpr auto rotl(std::uint64_t a_value, int a_shift) noexcept
+				-> std::uint64_t
+			{
+				return (a_value << a_shift) | (a_value >> (64 - a_shift));
+			}
+
+			[[nodiscard]] constexpr auto round(std::uint64_t a_acc, std::uint64_t a_input) noexcept
+				-> std::uint64_t
+			{
+				return rotl(a_acc + a_input * prime2, 31) * prime1;
+			}
+
+			[[nodiscard]] constexpr auto merge(std::uint64_t a_acc, std::uint64_t a_value) noexcept
+				-> std::uint64_t
+			{
+				return (a_acc ^ round(0, a_value)) * prime1 + prime4;
+			}
+
+			void reset(std::uint64_t (&a_acc)[4], std::uint64_t a_seed) noexcept
+			{
+				a_acc[0] = a_seed + prime1 + prime2;
+				a_acc[1] = a_seed + prime2;
+				a_acc[2] = a_seed;
+				a_acc[3] = a_seed - prime1;
+			}
+
+			// consumes whole 32 byte stripes, returning how many bytes were used
+			auto consume(
+				std::uint64_t (&a_acc)[4],
+				const unsigned char* a_data,
+				std::size_t a_size) noexcept
+				-> std::size_t
+			{
+				const auto stripes = a_size / 32;
+				for (std::size_t i = 0; i < stripes; ++i, a_data += 32) {
+					a_acc[0] = round(a_acc[0], load<std::uint64_t>(a_data));
+					a_acc[1] = round(a_acc[1], load<std::uint64_t>(a_data + 8));
+					a_acc[2] = round(a_acc[2], load<std::uint64_t>(a_data + 16));
+					a_acc[3] = round(a_acc[3], load<std::uint64_t>(a_data + 24));
+				}
+				return stripes * 32;
+			}
+
+			[[nodiscard]] auto finish(
+				const std::uint64_t (&a_acc)[4],
+				std::uint64_t a_seed,
+				std::uint64_t a_total,
+				const unsigned char* a_tail,
+				std::size_t a_size) noexcept
+				-> std::uint64_t
+			{
+				std::uint64_t h;
+				if (a_total >= 32) {
+					h = rotl(a_acc[0], 1) + rotl(a_acc[1], 7) + rotl(a_acc[2], 12) + rotl(a_acc[3], 18);
+					for (const auto acc : a_acc) {
+						h = merge(h, acc);
+					}
+				} else {
+					h = a_seed + prime5;
+				}
+				h += a_total;
+
+				for (; a_size >= 8; a_tail += 8, a_size -= 8) {
+					h ^= round(0, load<std::uint64_t>(a_tail));
+					h = rotl(h, 27) * prime1 + prime4;
+				}
+				if (a_size >= 4) {
+					h ^= std::uint64_t{ load<std::uint32_t>(a_tail) } * prime1;
+					h = rotl(h, 23) * prime2 + prime3;
+					a_tail += 4;
+					a_size -= 4;
+				}
+				for (; a_size > 0; ++a_tail, --a_size) {
+					h ^= *a_tail * prime5;
+					h = rotl(h, 11) * prime1;
+				}
+
+				h ^= h >> 33;
+				h *= prime2;
+				h ^= h >> 29;
+				h *= prime3;
+				h ^= h >> 32;
+				return h;
+			}
+		}
+
+		// asks the os to start reading pages in before we get to them
+		void prefetch(const std::byte* a_data, std::size_t a_size) noexcept
+		{
+#if MMIO_OS_WINDOWS
+#	if _WIN32_WINNT >= 0x0602
+			::WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::byte*>(a_data), a_size };
+			(void)::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+#	else
+			(void)a_data;
+			(void)a_size;
+#	endif
+#else
+			const auto page = detail::page_size();
+			const auto first = reinterpret_cast<std::uintptr_t>(a_data) / page * page;
+			const auto last = reinterpret_cast<std::uintptr_t>(a_data) + a_size;
+			(void)::madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+#endif
+		}
+
+		// Calls a_leaf(index, data, size) for every chunk of the input, from up to a_threads threads at once.
+		// Each thread hints the os to page in the chunk it will likely take next while it hashes the current one.
+		// Returns false if the work could not be parallelized, in which case nothing was called.
+		template <class F>
+		[[nodiscard]] bool for_each_chunk(
+			const std::byte* a_data,
+			std::size_t a_size,
+			std::size_t a_threads,
+			F a_leaf) noexcept
+		{
+			// clamping to [1, chunks] is undefined when there are no chunks at all
+			const auto chunks = (a_size + chunk_size - 1) / chunk_size;
+			if (chunks <= 1) {
+				return false;
+			}
+
+			auto threads = a_threads != 0 ? a_threads : static_cast<std::size_t>(std::thread::hardware_concurrency());
+			threads = std::clamp<std::size_t>(threads, 1, chunks);
+			if (threads <= 1) {
+				return false;
+			}
+
+			std::atomic_size_t next{ 0 };
+			const auto work = [&]() noexcept {
+				for (;;) {
+					const auto i = next.fetch_add(1, std::memory_order_relaxed);
+					if (i >= chunks) {
+						return;
+					}
+
+					const auto offset = i * chunk_size;
+					const auto ahead = offset + threads * chunk_size;
+					if (ahead < a_size) {
+						prefetch(a_data + ahead, (std::min)(chunk_size, a_size - ahead));
+					}
+					a_leaf(i, a_data + offset, (std::min)(chunk_size, a_size - offset));
+				}
+			};
+
+			std::vector<std::thread> pool;
+			try {
+				pool.reserve(threads - 1);
+				for (std::size_t i = 1; i < threads; ++i) {
+					pool.emplace_back(work);
+				}
+			} catch (...) {
+				// whatever threads did start will share the work with us
+			}
+
+			work();
+			for (auto& thread : pool) {
+				thread.join();
+			}
+			return true;
+		}
+	}
+
+	auto crc32c(
+		const void* a_data,
+		std::size_t a_size,
+		std::uint32_t a_crc) noexcept
+		-> std::uint32_t
+	{
+		return ~crc::update(~a_crc, static_cast<const unsigned char*>(a_data), a_size);
+	}
+
+	auto crc32c_combine(
+		std::uint32_t a_first,
+		std::uint32_t a_second,
+		std::size_t a_secondSize) noexcept
+		-> std::uint32_t
+	{
+		return crc::multmodp(crc::x2nmodp(a_secondSize, 3), a_first) ^ a_second;
+	}
+
+	template <mapmode MODE>
+	auto crc32c(
+		const mapped_file<MODE>& a_file,
+		const hash_options& a_options) noexcept
+		-> std::uint32_t
+	{
+		const auto data = a_file.map();
+		const auto size = data != nullptr ? a_file.size() : 0;
+
+		try {
+			std::vector<std::uint32_t> leaves((size + chunk_size - 1) / chunk_size);
+			const auto parallel = for_each_chunk(data, size, a_options.threads, [&](std::size_t a_index, const std::byte* a_chunk, std::size_t a_size) noexcept {
+				leaves[a_index] = crc32c(a_chunk, a_size);
+			});
+
+			if (parallel) {
+				std::uint32_t result = 0;
+				for (std::size_t i = 0; i < leaves.size(); ++i) {
+					result = crc32c_combine(result, leaves[i], (std::min)(chunk_size, size - i * chunk_size));
+				}
+				return result;
+			}
+		} catch (...) {}
+
+		return crc32c(data, size);
+	}
+
+	auto xxh64(
+		const void* a_data,
+		std::size_t a_size,
+		std::uint64_t a_seed) noexcept
+		-> std::uint64_t
+	{
+		const auto data = static_cast<const unsigned char*>(a_data);
+		std::uint64_t acc[4];
+		xxh::reset(acc, a_seed);
+		const auto consumed = xxh::consume(acc, data, a_size);
+		return xxh::finish(acc, a_seed, a_size, data + consumed, a_size - consumed);
+	}
+
+	auto content_hash(
+		const void* a_data,
+		std::size_t a_size,
+		const hash_options& a_options) noexcept
+		-> std::uint64_t
+	{
+		const auto data = static_cast<const std::byte*>(a_data);
+		const auto count = (a_size + chunk_size - 1) / chunk_size;
+		const auto leaf = [&](std::size_t a_index) noexcept {
+			const auto offset = a_index * chunk_size;
+			return xxh64(data + offset, (std::min)(chunk_size, a_size - offset), a_index);
+		};
+
+		// the root hashes the little-endian leaf hashes, seeded with the total size
+		xxh64_hasher root{ a_size };
+		const auto append = [&](std::uint64_t a_leaf) noexcept {
+			unsigned char bytes[8];
+			for (std::size_t i = 0; i < 8; ++i) {
+				bytes[i] = static_cast<unsigned char>(a_leaf >> (i * 8));
+			}
+			root.update(bytes, sizeof(bytes));
+		};
+
+		try {
+			std::vector<std::uint64_t> leaves(count);
+			const auto parallel = for_each_chunk(data, a_size, a_options.threads, [&](std::size_t a_index, const std::byte*, std::size_t) noexcept {
+				leaves[a_index] = leaf(a_index);
+			});
+
+			if (parallel) {
+				for (const auto hash : leaves) {
+					append(hash);
+				}
+				return root.digest();
+			}
+		} catch (...) {}
+
+		for (std::size_t i = 0; i < count; ++i) {
+			append(leaf(i));
+		}
+		return root.digest();
+	}
+
+	template <mapmode MODE>
+	auto content_hash(
+		const mapped_file<MODE>& a_file,
+		const hash_options& a_options) noexcept
+		-> std::uint64_t
+	{
+		const auto data = a_file.map();
+		return content_hash(data, data != nullptr ? a_file.size() : 0, a_options);
+	}
+
+	auto xxh64_hasher::digest() const noexcept
+		-> std::uint64_t
+	{
+		return xxh::finish(
+			this->_accumulators,
+			this->_seed,
+			this->_total,
+			reinterpret_cast<const unsigned char*>(this->_buffer),
+			this->_buffered);
+	}
+
+	void xxh64_hasher::reset(std::uint64_t a_seed) noexcept
+	{
+		xxh::reset(this->_accumulators, a_seed);
+		this->_seed = a_seed;
+		this->_total = 0;
+		this->_buffered = 0;
+	}
+
+	void xxh64_hasher::update(const void* a_data, std::size_t a_size) noexcept
+	{
+		auto data = static_cast<const unsigned char*>(a_data);
+		this->_total += a_size;
+
+		const auto buffer = reinterpret_cast<unsigned char*>(this->_buffer);
+		if (this->_buffered != 0) {
+			const auto fill = (std::min)(a_size, sizeof(this->_buffer) - this->_buffered);
+			std::memcpy(buffer + this->_buffered, data, fill);
+			this->_buffered += fill;
+			data += fill;
+			a_size -= fill;
+			if (this->_buffered < sizeof(this->_buffer)) {
+				return;
+			}
+			(void)xxh::consume(this->_accumulators, buffer, sizeof(this->_buffer));
+			this->_buffered = 0;
+		}
+
+		const auto consumed = xxh::consume(this->_accumulators, data, a_size);
+		data += consumed;
+		a_size -= consumed;
+		if (a_size != 0) {
+			std::memcpy(buffer, data, a_size);
+			this->_buffered = a_size;
+		}
+	}
+
+	template auto crc32c(const mapped_file<mapmode::readonly>&, const hash_options&) noexcept -> std::uint32_t;
+	template auto crc32c(const mapped_file<mapmode::readwrite>&, const hash_options&) noexcept -> std::uint32_t;
+	template auto content_hash(const mapped_file<mapmode::readonly>&, const hash_options&) noexcept -> std::uint64_t;
+	template auto content_hash(const mapped_file<mapmode::readwrite>&, const hash_options&) noexcept -> std::uint64_t;
+}
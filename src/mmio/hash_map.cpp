@@ -0,0 +1,294 @@
+#include "mmio/hash_map.hpp"
+#include "mmio/hash.hpp"
+#include "mmio/os.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define MMIO_HASH_MAP_SSE2 true
+#	include <emmintrin.h>
+#else
+#	define MMIO_HASH_MAP_SSE2 false
+#endif
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+namespace mmio::detail
+{
+	namespace
+	{
+		constexpr char hash_map_magic[8] = { 'M', 'M', 'I', 'O', 'H', 'M', 'P', '\0' };
+		constexpr std::uint32_t hash_map_version = 1;
+		constexpr std::uint64_t hash_map_seed = 0;
+		constexpr std::size_t cache_line = 64;
+		constexpr std::size_t group_width = 16;
+
+		// a tag of 0 marks an empty slot, anything else is 0x80 | the low 7 bits of the hash
+		constexpr std::uint8_t empty_tag = 0;
+
+		// [header][tags, 16 per group][entries, 16 per group]
+		struct hash_map_header final
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t key_size;
+			std::uint32_t value_size;
+			std::uint32_t value_offset;
+			std::uint32_t entry_size;
+			std::uint32_t reserved;
+			std::uint64_t group_count;
+			std::uint64_t size;
+			std::uint64_t seed;
+		};
+
+		static_assert(sizeof(hash_map_header) <= cache_line);
+
+		[[nodiscard]] constexpr auto entries_offset(std::uint64_t a_groupCount) noexcept
+			-> std::uint64_t
+		{
+			return cache_line + (a_groupCount * group_width + cache_line - 1) / cache_line * cache_line;
+		}
+
+		[[nodiscard]] constexpr auto make_tag(std::uint64_t a_hash) noexcept
+			-> std::uint8_t
+		{
+			return static_cast<std::uint8_t>(0x80 | (a_hash & 0x7F));
+		}
+
+		// a bitmask of which of the group's 16 tags equal a_tag
+		[[nodiscard]] auto match(const std::byte* a_tags, std::uint8_t a_tag) noexcept
+			-> std::uint32_t
+		{
+#if MMIO_HASH_MAP_SSE2
+			const auto tags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_tags));
+			const auto matches = _mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(a_tag)));
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
+#else
+			std::uint32_t result = 0;
+			for (std::size_t i = 0; i < group_width; ++i) {
+				result |= static_cast<std::uint32_t>(std::to_integer<std::uint8_t>(a_tags[i]) == a_tag) << i;
+			}
+			return result;
+#endif
+		}
+
+		[[nodiscard]] auto lowest_bit(std::uint32_t a_mask) noexcept
+			-> std::size_t
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			::_BitScanForward(&index, a_mask);
+			return index;
+#else
+			return static_cast<std::size_t>(__builtin_ctz(a_mask));
+#endif
+		}
+
+		// visits every group exactly once, as long as the group count is a power of two
+		class probe final
+		{
+		public:
+			probe(std::uint64_t a_hash, std::uint64_t a_mask) noexcept :
+				_group((a_hash >> 7) & a_mask),
+				_mask(a_mask)
+			{}
+
+			[[nodiscard]] auto group() const noexcept -> std::uint64_t { return this->_group; }
+
+			void next() noexcept
+			{
+				++this->_stride;
+				this->_group = (this->_group + this->_stride) & this->_mask;
+			}
+
+		private:
+			std::uint64_t _group;
+			std::uint64_t _mask;
+			std::uint64_t _stride{ 0 };
+		};
+	}
+
+	auto open_hash_map(
+		const mapped_file_source& a_file,
+		const hash_map_layout& a_layout,
+		hash_map_view& a_view) noexcept
+		-> std::error_code
+	{
+		const auto bad = std::make_error_code(std::errc::bad_message);
+		if (a_file.size() < sizeof(hash_map_header)) {
+			return bad;
+		}
+
+		hash_map_header header;
+		std::memcpy(&header, a_file.data(), sizeof(header));
+		if (std::memcmp(header.magic, hash_map_magic, sizeof(hash_map_magic)) != 0 ||
+			header.version != hash_map_version ||
+			header.key_size != a_layout.key_size ||
+			header.value_size != a_layout.value_size ||
+			header.value_offset != a_layout.value_offset ||
+			header.entry_size != a_layout.entry_size) {
+			return bad;
+		}
+
+		// the group count comes from the file, so make sure the sizes derived from it can't overflow
+		const auto groups = header.group_count;
+		if (groups == 0 ||
+			(groups & (groups - 1)) != 0 ||
+			groups > a_file.size() / group_width / (std::uint64_t{ 1 } + header.entry_size) ||
+			header.size > groups * group_width ||
+			a_file.size() < entries_offset(groups) + groups * group_width * header.entry_size) {
+			return bad;
+		}
+
+		a_view.group_mask = groups - 1;
+		a_view.size = header.size;
+		a_view.entries_offset = static_cast<std::size_t>(entries_offset(groups));
+		a_view.layout = a_layout;
+		return {};
+	}
+
+	auto find_hash_map(
+		const std::byte* a_base,
+		const hash_map_view& a_view,
+		const void* a_key) noexcept
+		-> const std::byte*
+	{
+		if (a_view.size == 0) {
+			return nullptr;
+		}
+
+		const auto tags = a_base + cache_line;
+		const auto entries = a_base + a_view.entries_offset;
+		const auto entrySize = a_view.layout.entry_size;
+		const auto hash = xxh64(a_key, a_view.layout.key_size, hash_map_seed);
+		const auto tag = make_tag(hash);
+
+		probe p{ hash, a_view.group_mask };
+		for (std::uint64_t i = 0; i <= a_view.group_mask; ++i, p.next()) {
+			const auto group = static_cast<std::size_t>(p.group());
+			const auto groupTags = tags + group * group_width;
+			for (auto candidates = match(groupTags, tag); candidates != 0; candidates &= candidates - 1) {
+				const auto entry = entries + (group * group_width + lowest_bit(candidates)) * entrySize;
+				if (std::memcmp(entry, a_key, a_view.layout.key_size) == 0) {
+					return entry;
+				}
+			}
+
+			// keys are never removed, so the first empty slot along the probe ends the search
+			if (match(groupTags, empty_tag) != 0) {
+				return nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
+	auto write_hash_map(
+		const std::filesystem::path& a_path,
+		const hash_map_layout& a_layout,
+		const std::byte* a_entries,
+		std::size_t a_count) noexcept
+		-> std::error_code
+	{
+		// keep the load factor at or below 7/8, so every probe sequence runs into an empty slot
+		std::uint64_t groups = 1;
+		while (groups * group_width * 7 / 8 < a_count) {
+			if (groups > (std::numeric_limits<std::size_t>::max)() / group_width / 2 / (std::uint64_t{ 1 } + a_layout.entry_size)) {
+				return std::make_error_code(std::errc::file_too_large);
+			}
+			groups *= 2;
+		}
+
+		const auto entriesOffset = static_cast<std::size_t>(entries_offset(groups));
+		const auto fileSize = entriesOffset + static_cast<std::size_t>(groups) * group_width * a_layout.entry_size;
+
+		std::filesystem::path temporary;
+		try {
+			temporary = temporary_path(a_path);
+		} catch (...) {
+			return std::make_error_code(std::errc::not_enough_memory);
+		}
+
+		std::error_code error;
+		std::filesystem::remove(temporary, error);
+		mapped_file_sink file;
+		if (auto result = file.open(temporary, fileSize); !result) {
+			std::filesystem::remove(temporary, error);
+			return *result;
+		}
+
+		const auto base = file.data();
+		const auto tags = base + cache_line;
+		const auto entries = base + entriesOffset;
+		std::memset(tags, 0, entriesOffset - cache_line);
+
+		std::uint64_t size = 0;
+		for (std::size_t i = 0; i < a_count; ++i) {
+			const auto source = a_entries + i * a_layout.entry_size;
+			const auto hash = xxh64(source, a_layout.key_size, hash_map_seed);
+			const auto tag = make_tag(hash);
+
+			for (probe p{ hash, groups - 1 };; p.next()) {
+				const auto group = static_cast<std::size_t>(p.group());
+				const auto groupTags = tags + group * group_width;
+
+				std::byte* slot = nullptr;
+				for (auto candidates = match(groupTags, tag); candidates != 0; candidates &= candidates - 1) {
+					const auto entry = entries + (group * group_width + lowest_bit(candidates)) * a_layout.entry_size;
+					if (std::memcmp(entry, source, a_layout.key_size) == 0) {
+						slot = entry;
+						break;
+					}
+				}
+
+				if (slot == nullptr) {
+					if (const auto empty = match(groupTags, empty_tag); empty != 0) {
+						const auto index = lowest_bit(empty);
+						groupTags[index] = static_cast<std::byte>(tag);
+						slot = entries + (group * group_width + index) * a_layout.entry_size;
+						++size;
+					}
+				}
+
+				if (slot != nullptr) {
+					std::memcpy(slot, source, a_layout.entry_size);
+					break;
+				}
+			}
+		}
+
+		const hash_map_header header{
+			{},
+			hash_map_version,
+			a_layout.key_size,
+			a_layout.value_size,
+			a_layout.value_offset,
+			a_layout.entry_size,
+			0,
+			groups,
+			size,
+			hash_map_seed
+		};
+		std::memcpy(base, &header, sizeof(header));
+		std::memcpy(base, hash_map_magic, sizeof(hash_map_magic));
+
+		// the table has to be on disk before it replaces the old one, or a crash could leave an unwritten file in its place
+		error = sync(file) ? std::error_code() : std::make_error_code(decode_os_error());
+		file.close();
+
+		if (!error) {
+			std::filesystem::rename(temporary, a_path, error);
+		}
+		if (error) {
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+		}
+		return error;
+	}
+}
@@ -1,63 +1,19 @@
 #include "mmio/mmio.hpp"
+#include "mmio/os.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
 #include <system_error>
 #include <type_traits>
 #include <utility>
 
-#if MMIO_OS_WINDOWS
-#	define WIN32_LEAN_AND_MEAN
-
-#	define NOGDICAPMASKS
-#	define NOVIRTUALKEYCODES
-#	define NOWINMESSAGES
-#	define NOWINSTYLES
-#	define NOSYSMETRICS
-#	define NOMENUS
-#	define NOICONS
-#	define NOKEYSTATES
-#	define NOSYSCOMMANDS
-#	define NORASTEROPS
-#	define NOSHOWWINDOW
-#	define OEMRESOURCE
-#	define NOATOM
-#	define NOCLIPBOARD
-#	define NOCOLOR
-#	define NOCTLMGR
-#	define NODRAWTEXT
-#	define NOGDI
-#	define NOKERNEL
-#	define NOUSER
-#	define NONLS
-#	define NOMB
-#	define NOMEMMGR
-#	define NOMETAFILE
-#	define NOMINMAX
-#	define NOMSG
-#	define NOOPENFILE
-#	define NOSCROLL
-#	define NOSERVICE
-#	define NOSOUND
-#	define NOTEXTMETRIC
-#	define NOWH
-#	define NOWINOFFSETS
-#	define NOCOMM
-#	define NOKANJI
-#	define NOHELP
-#	define NOPROFILER
-#	define NODEFERWINDOWPOS
-#	define NOMCX
-
-#	include <Windows.h>
-#else
-#	include <fcntl.h>
-#	include <sys/mman.h>
-#	include <sys/stat.h>
-#	include <unistd.h>
-#endif
-
 namespace mmio
 {
 #if MMIO_OS_WINDOWS
@@ -284,7 +240,33 @@ namespace mmio
 		}
 #endif
 
-		[[nodiscard]] auto decode_os_error() noexcept
+		// lazily mapped files serialize their first access through one of these, chosen by address
+		[[nodiscard]] auto lazy_lock(const void* a_file) noexcept
+			-> std::mutex&
+		{
+			static std::mutex locks[16];
+			return locks[std::hash<const void*>{}(a_file) % std::size(locks)];
+		}
+
+		// keeps each request within what a single syscall can report back
+		constexpr std::size_t max_transfer_chunk = std::size_t{ 1 } << 30;
+
+#if !MMIO_OS_WINDOWS
+		// errors which mean the syscall can not handle this pair of descriptors, rather than an io failure
+		[[nodiscard]] bool is_unsupported_transfer(posix_error_t a_error) noexcept
+		{
+			return a_error == EINVAL ||
+			       a_error == ENOSYS ||
+			       a_error == EXDEV ||
+			       a_error == EBADF ||
+			       a_error == EOPNOTSUPP;
+		}
+#endif
+	}
+
+	namespace detail
+	{
+		auto decode_os_error() noexcept
 			-> std::errc
 		{
 #if MMIO_OS_WINDOWS
@@ -369,14 +351,53 @@ namespace mmio
 			return posix_to_errc(errno);
 #endif
 		}
+
+		auto page_size() noexcept
+			-> std::size_t
+		{
+#if MMIO_OS_WINDOWS
+			::SYSTEM_INFO info = {};
+			::GetSystemInfo(&info);
+			return static_cast<std::size_t>(info.dwAllocationGranularity);
+#else
+			return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+		}
+
+		bool sync(const mapped_file_sink& a_file) noexcept
+		{
+			const auto& handle = a_file.native_handle();
+#if MMIO_OS_WINDOWS
+			return ::FlushViewOfFile(handle.base_address, 0) != 0 &&
+			       ::FlushFileBuffers(handle.file) != 0;
+#else
+			return ::msync(handle.addr, a_file.size(), MS_SYNC) == 0 &&
+			       ::fsync(handle.fd) == 0;
+#endif
+		}
+
+		auto temporary_path(const std::filesystem::path& a_path)
+			-> std::filesystem::path
+		{
+			static std::atomic_uint64_t counter{ 0 };
+#if MMIO_OS_WINDOWS
+			const auto pid = static_cast<std::uint64_t>(::GetCurrentProcessId());
+#else
+			const auto pid = static_cast<std::uint64_t>(::getpid());
+#endif
+			auto result = a_path;
+			result += ".tmp." + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+			return result;
+		}
 	}
 
 	template <mapmode MODE>
 	mapped_file<MODE>::mapped_file(
 		std::filesystem::path a_path,
-		std::size_t a_size)
+		std::size_t a_size,
+		loadmode a_load)
 	{
-		auto result = this->open(std::move(a_path), a_size);
+		auto result = this->open(std::move(a_path), a_size, a_load);
 		if (!result) {
 			throw std::system_error{ *result };
 		}
@@ -385,13 +406,10 @@ namespace mmio
 	template <mapmode MODE>
 	void mapped_file<MODE>::close() noexcept
 	{
-#if MMIO_OS_WINDOWS
-		if (this->_handle.base_address != nullptr) {
-			[[maybe_unused]] const auto success = ::UnmapViewOfFile(this->_handle.base_address);
-			assert(success != 0);
-			this->_handle.base_address = nullptr;
-		}
+		this->do_unmap();
+		this->_load = loadmode::eager;
 
+#if MMIO_OS_WINDOWS
 		if (this->_handle.file_mapping_object != nullptr) {
 			[[maybe_unused]] const auto success = ::CloseHandle(this->_handle.file_mapping_object);
 			assert(success != 0);
@@ -405,16 +423,6 @@ namespace mmio
 			this->_size = 0;
 		}
 #else
-		if (this->_handle.addr != MAP_FAILED) {
-			if constexpr (MODE == mapmode::readwrite) {
-				[[maybe_unused]] const auto success = ::msync(this->_handle.addr, this->_size, MS_SYNC);
-				assert(success == 0);
-			}
-			[[maybe_unused]] const auto success = ::munmap(this->_handle.addr, this->_size);
-			assert(success == 0);
-			this->_handle.addr = MAP_FAILED;
-		}
-
 		if (this->_handle.fd != -1) {
 			[[maybe_unused]] const auto success = ::close(this->_handle.fd);
 			assert(success == 0);
@@ -425,55 +433,248 @@ namespace mmio
 	}
 
 	template <mapmode MODE>
-	auto mapped_file<MODE>::data() const noexcept
-		-> value_type*
+	auto mapped_file<MODE>::copy_to(
+		native_file_type a_file,
+		std::size_t a_offset,
+		std::size_t a_length) const noexcept
+		-> transfer_result
 	{
+		if (!this->is_open() || a_offset > this->_size || a_length > this->_size - a_offset) {
+			return { std::make_error_code(std::errc::invalid_argument), 0 };
+		}
+
+		std::size_t transferred = 0;
 #if MMIO_OS_WINDOWS
-		return static_cast<value_type*>(this->_handle.base_address);
+		const auto data = this->map();
+		if (data == nullptr) {
+			return { std::make_error_code(detail::decode_os_error()), 0 };
+		}
+
+		while (transferred < a_length) {
+			const auto chunk = static_cast<::DWORD>((std::min)(a_length - transferred, max_transfer_chunk));
+			::DWORD written = 0;
+			if (::WriteFile(a_file, data + a_offset + transferred, chunk, &written, nullptr) == 0) {
+				return { std::make_error_code(detail::decode_os_error()), transferred };
+			}
+			transferred += written;
+		}
 #else
-		return this->_handle.addr != MAP_FAILED ?
-		           static_cast<value_type*>(this->_handle.addr) :
-		           nullptr;
+		bool copyFileRange = true;
+		bool sendFile = true;
+		while (transferred < a_length) {
+			const auto chunk = std::min(a_length - transferred, max_transfer_chunk);
+			::ssize_t result = -1;
+			if (copyFileRange) {
+				::loff_t offset = a_offset + transferred;
+				result = ::copy_file_range(this->_handle.fd, &offset, a_file, nullptr, chunk, 0);
+				if (result == 0 || (result == -1 && is_unsupported_transfer(errno))) {
+					copyFileRange = false;
+					continue;
+				}
+			} else if (sendFile) {
+				::off_t offset = a_offset + transferred;
+				result = ::sendfile(a_file, this->_handle.fd, &offset, chunk);
+				if (result == 0 || (result == -1 && is_unsupported_transfer(errno))) {
+					sendFile = false;
+					continue;
+				}
+			} else if (const auto data = this->map(); data != nullptr) {
+				result = ::write(a_file, data + a_offset + transferred, chunk);
+			}  // else errno is left over from the failed mmap
+
+			if (result == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return { std::make_error_code(detail::decode_os_error()), transferred };
+			} else if (result == 0) {
+				return { std::make_error_code(std::errc::io_error), transferred };
+			}
+			transferred += static_cast<std::size_t>(result);
+		}
 #endif
+
+		return { std::error_code(), transferred };
+	}
+
+	template <mapmode MODE>
+	auto mapped_file<MODE>::open(
+		std::filesystem::path a_path,
+		std::size_t a_size,
+		loadmode a_load) noexcept
+		-> open_result
+	{
+		return this->do_open(std::move(a_path), a_size, a_load, openmode::standard);
 	}
 
 	template <mapmode MODE>
-	bool mapped_file<MODE>::is_open() const noexcept
+	auto mapped_file<MODE>::send_to(
+		native_socket_type a_socket,
+		std::size_t a_offset,
+		std::size_t a_length) const noexcept
+		-> transfer_result
 	{
+		if (!this->is_open() || a_offset > this->_size || a_length > this->_size - a_offset) {
+			return { std::make_error_code(std::errc::invalid_argument), 0 };
+		}
+
+		std::size_t transferred = 0;
 #if MMIO_OS_WINDOWS
-		return this->_handle.base_address != nullptr;
+		const auto socket = static_cast<::SOCKET>(a_socket);
+		bool transmitFile = true;
+		while (transferred < a_length) {
+			const auto chunk = (std::min)(a_length - transferred, max_transfer_chunk);
+			if (transmitFile) {
+				// the file offset is taken from the OVERLAPPED, so the handle's own position is left alone
+				const auto offset = static_cast<std::uint64_t>(a_offset + transferred);
+				::OVERLAPPED overlapped = {};
+				overlapped.Offset = static_cast<::DWORD>(offset);
+				overlapped.OffsetHigh = static_cast<::DWORD>(offset >> 32);
+				overlapped.hEvent = ::WSACreateEvent();
+				if (overlapped.hEvent == WSA_INVALID_EVENT) {
+					return { std::make_error_code(detail::decode_os_error()), transferred };
+				}
+
+				::DWORD sent = 0;
+				::DWORD flags = 0;
+				const auto success =
+					(::TransmitFile(socket, this->_handle.file, static_cast<::DWORD>(chunk), 0, &overlapped, nullptr, 0) != FALSE ||
+						::WSAGetLastError() == WSA_IO_PENDING) &&
+					::WSAGetOverlappedResult(socket, &overlapped, &sent, TRUE, &flags) != FALSE;
+				const auto error = ::WSAGetLastError();
+				[[maybe_unused]] const auto closed = ::WSACloseEvent(overlapped.hEvent);
+				assert(closed != FALSE);
+
+				if (!success) {
+					// connectionless sockets can't be used with TransmitFile
+					if (transferred == 0 && (error == WSAEOPNOTSUPP || error == WSAEINVAL)) {
+						transmitFile = false;
+						continue;
+					}
+					::WSASetLastError(error);
+					return { std::make_error_code(detail::decode_os_error()), transferred };
+				} else if (sent == 0) {
+					return { std::make_error_code(std::errc::io_error), transferred };
+				}
+				transferred += sent;
+			} else if (const auto data = this->map(); data == nullptr) {
+				return { std::make_error_code(detail::decode_os_error()), transferred };
+			} else {
+				const auto result = ::send(
+					socket,
+					reinterpret_cast<const char*>(data + a_offset + transferred),
+					static_cast<int>(chunk),
+					0);
+				if (result == SOCKET_ERROR) {
+					return { std::make_error_code(detail::decode_os_error()), transferred };
+				}
+				transferred += static_cast<std::size_t>(result);
+			}
+		}
 #else
-		return this->_handle.addr != MAP_FAILED;
+		bool sendFile = true;
+		while (transferred < a_length) {
+			const auto chunk = std::min(a_length - transferred, max_transfer_chunk);
+			::ssize_t result = -1;
+			if (sendFile) {
+				::off_t offset = a_offset + transferred;
+				result = ::sendfile(a_socket, this->_handle.fd, &offset, chunk);
+				if (result == 0 || (result == -1 && is_unsupported_transfer(errno))) {
+					sendFile = false;
+					continue;
+				}
+			} else if (const auto data = this->map(); data != nullptr) {
+				result = ::send(a_socket, data + a_offset + transferred, chunk, MSG_NOSIGNAL);
+			}  // else errno is left over from the failed mmap
+
+			if (result == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return { std::make_error_code(detail::decode_os_error()), transferred };
+			} else if (result == 0) {
+				return { std::make_error_code(std::errc::io_error), transferred };
+			}
+			transferred += static_cast<std::size_t>(result);
+		}
 #endif
+
+		return { std::error_code(), transferred };
 	}
 
 	template <mapmode MODE>
-	auto mapped_file<MODE>::open(
+	auto mapped_file<MODE>::map() const noexcept
+		-> value_type*
+	{
+		// once mapped, this never touches the lock
+		if (const auto data = this->_mapped.load(std::memory_order_acquire); data != nullptr) {
+			return data;
+		}
+
+		const std::lock_guard lock{ lazy_lock(this) };
+		if (this->_mapped.load(std::memory_order_relaxed) == nullptr && this->is_open()) {
+			(void)this->do_map();  // a failure leaves us returning nullptr, and is retried on the next call
+		}
+		return this->_mapped.load(std::memory_order_relaxed);
+	}
+
+	template <mapmode MODE>
+	void mapped_file<MODE>::unmap_idle() noexcept
+	{
+		const std::lock_guard lock{ lazy_lock(this) };
+		if (this->is_open()) {
+			this->do_unmap();
+			this->_load = loadmode::lazy;
+		}
+	}
+
+	template <mapmode MODE>
+	auto mapped_file<MODE>::do_open(
 		std::filesystem::path a_path,
-		std::size_t a_size) noexcept
+		std::size_t a_size,
+		loadmode a_load,
+		openmode a_mode) noexcept
 		-> open_result
 	{
 		this->close();
-		if (this->do_open(a_path.c_str(), a_size)) {
+		this->_load = a_load;
+		if (this->do_open(a_path.c_str(), a_size, a_mode)) {
 			return { std::error_code() };
 		} else {
 			this->close();
-			return { std::make_error_code(decode_os_error()) };
+			return { std::make_error_code(detail::decode_os_error()) };
 		}
 	}
 
 #if MMIO_OS_WINDOWS
+	template <mapmode MODE>
+	bool mapped_file<MODE>::do_map() const noexcept
+	{
+		this->_handle.base_address = ::MapViewOfFile(
+			this->_handle.file_mapping_object,
+			MODE == mapmode::readonly ? FILE_MAP_READ : FILE_MAP_READ | FILE_MAP_WRITE,
+			0,
+			0,
+			0);
+		this->_data = static_cast<value_type*>(this->_handle.base_address);
+		this->_mapped.store(this->_data, std::memory_order_release);
+		return this->_data != nullptr;
+	}
+
 	template <mapmode MODE>
 	bool mapped_file<MODE>::do_open(
 		const wchar_t* a_path,
-		std::size_t a_size) noexcept
+		std::size_t a_size,
+		openmode a_mode) noexcept
 	{
 		this->_handle.file = ::CreateFileW(
 			a_path,
 			MODE == mapmode::readonly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
-			MODE == mapmode::readonly ? FILE_SHARE_READ : FILE_SHARE_READ | FILE_SHARE_WRITE,
+			MODE == mapmode::readonly && a_mode != openmode::shared ? FILE_SHARE_READ : FILE_SHARE_READ | FILE_SHARE_WRITE,
 			nullptr,
-			MODE == mapmode::readonly ? OPEN_EXISTING : CREATE_ALWAYS,
+			MODE == mapmode::readonly || a_mode == openmode::existing ? OPEN_EXISTING :
+			a_mode == openmode::shared                                ? OPEN_ALWAYS :
+			                                                            CREATE_ALWAYS,
 			MODE == mapmode::readonly ? FILE_ATTRIBUTE_READONLY : FILE_ATTRIBUTE_NORMAL,
 			nullptr);
 		if (this->_handle.file == INVALID_HANDLE_VALUE) {
@@ -501,27 +702,49 @@ namespace mmio
 			return false;
 		}
 
-		this->_handle.base_address = ::MapViewOfFile(
-			this->_handle.file_mapping_object,
-			MODE == mapmode::readonly ? FILE_MAP_READ : FILE_MAP_READ | FILE_MAP_WRITE,
-			0,
-			0,
+		return this->_load == loadmode::lazy || this->do_map();
+	}
+
+	template <mapmode MODE>
+	void mapped_file<MODE>::do_unmap() const noexcept
+	{
+		if (this->_handle.base_address != nullptr) {
+			[[maybe_unused]] const auto success = ::UnmapViewOfFile(this->_handle.base_address);
+			assert(success != 0);
+			this->_handle.base_address = nullptr;
+			this->_data = nullptr;
+			this->_mapped.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+#else
+	template <mapmode MODE>
+	bool mapped_file<MODE>::do_map() const noexcept
+	{
+		this->_handle.addr = ::mmap(
+			nullptr,
+			this->_size,
+			MODE == mapmode::readonly ? PROT_READ : PROT_READ | PROT_WRITE,
+			MAP_SHARED,
+			this->_handle.fd,
 			0);
-		if (this->_handle.base_address == nullptr) {
+		if (this->_handle.addr == MAP_FAILED) {
 			return false;
 		}
 
+		this->_data = static_cast<value_type*>(this->_handle.addr);
+		this->_mapped.store(this->_data, std::memory_order_release);
 		return true;
 	}
-#else
+
 	template <mapmode MODE>
 	bool mapped_file<MODE>::do_open(
 		const char* a_path,
-		std::size_t a_size) noexcept
+		std::size_t a_size,
+		openmode a_mode) noexcept
 	{
 		this->_handle.fd = ::open(
 			a_path,
-			MODE == mapmode::readonly ? O_RDONLY : O_RDWR | O_CREAT,
+			MODE == mapmode::readonly ? O_RDONLY : a_mode == openmode::existing ? O_RDWR : O_RDWR | O_CREAT,
 			S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);  // -rw-r--r--
 		if (this->_handle.fd == -1) {
 			return false;
@@ -541,18 +764,32 @@ namespace mmio
 		}
 		this->_size = static_cast<std::size_t>(s.st_size);
 
-		this->_handle.addr = ::mmap(
-			nullptr,
-			this->_size,
-			MODE == mapmode::readonly ? PROT_READ : PROT_READ | PROT_WRITE,
-			MAP_SHARED,
-			this->_handle.fd,
-			0);
-		if (this->_handle.addr == MAP_FAILED) {
-			return false;
+		if (this->_load == loadmode::lazy) {
+			// fail now like an eager `mmap` would, rather than on first access
+			if (this->_size == 0) {
+				errno = EINVAL;
+				return false;
+			}
+			return true;
+		} else {
+			return this->do_map();
 		}
+	}
 
-		return true;
+	template <mapmode MODE>
+	void mapped_file<MODE>::do_unmap() const noexcept
+	{
+		if (this->_handle.addr != MAP_FAILED) {
+			if constexpr (MODE == mapmode::readwrite) {
+				[[maybe_unused]] const auto success = ::msync(this->_handle.addr, this->_size, MS_SYNC);
+				assert(success == 0);
+			}
+			[[maybe_unused]] const auto success = ::munmap(this->_handle.addr, this->_size);
+			assert(success == 0);
+			this->_handle.addr = MAP_FAILED;
+			this->_data = nullptr;
+			this->_mapped.store(nullptr, std::memory_order_relaxed);
+		}
 	}
 #endif
 
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+
+#include "mmio/mmio.hpp"
+
+#if MMIO_OS_WINDOWS
+#	define WIN32_LEAN_AND_MEAN
+
+#	define NOGDICAPMASKS
+#	define NOVIRTUALKEYCODES
+#	define NOWINMESSAGES
+#	define NOWINSTYLES
+#	define NOSYSMETRICS
+#	define NOMENUS
+#	define NOICONS
+#	define NOKEYSTATES
+#	define NOSYSCOMMANDS
+#	define NORASTEROPS
+#	define NOSHOWWINDOW
+#	define OEMRESOURCE
+#	define NOATOM
+#	define NOCLIPBOARD
+#	define NOCOLOR
+#	define NOCTLMGR
+#	define NODRAWTEXT
+#	define NOGDI
+#	define NOKERNEL
+#	define NOUSER
+#	define NONLS
+#	define NOMB
+#	define NOMEMMGR
+#	define NOMETAFILE
+#	define NOMINMAX
+#	define NOMSG
+#	define NOOPENFILE
+#	define NOSCROLL
+#	define NOSERVICE
+#	define NOSOUND
+#	define NOTEXTMETRIC
+#	define NOWH
+#	define NOWINOFFSETS
+#	define NOCOMM
+#	define NOKANJI
+#	define NOHELP
+#	define NOPROFILER
+#	define NODEFERWINDOWPOS
+#	define NOMCX
+
+#	include <WinSock2.h>
+#	include <Windows.h>
+
+#	include <MSWSock.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/sendfile.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace mmio::detail
+{
+	// translates the calling thread's last os error (`GetLastError()`/`errno`)
+	[[nodiscard]] auto decode_os_error() noexcept
+		-> std::errc;
+
+	// the granularity at which files can be mapped
+	[[nodiscard]] auto page_size() noexcept
+		-> std::size_t;
+
+	// blocks until the mapping's contents and the file's metadata are on disk
+	[[nodiscard]] bool sync(const mapped_file_sink& a_file) noexcept;
+
+	// a sibling of a_path which no other thread or process will pick, for writing a file before renaming it into place
+	[[nodiscard]] auto temporary_path(const std::filesystem::path& a_path)
+		-> std::filesystem::path;
+}
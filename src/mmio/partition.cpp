@@ -0,0 +1,88 @@
+#include "mmio/partition.hpp"
+#include "mmio/os.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <system_error>
+
+namespace mmio
+{
+	partitioned_writer::partitioned_writer(
+		mapped_file_sink& a_file,
+		std::size_t a_partitionSize) noexcept :
+		_file(&a_file)
+	{
+		const auto pageSize = detail::page_size();
+		const auto size = (std::max)(a_partitionSize, std::size_t{ 1 });
+		this->_partitionSize = (size + pageSize - 1) / pageSize * pageSize;
+		this->_partitionCount = a_file.map() != nullptr ? (a_file.size() + this->_partitionSize - 1) / this->_partitionSize : 0;
+	}
+
+	auto partitioned_writer::finish() noexcept
+		-> open_result
+	{
+		if (!this->_file->is_open()) {
+			return { std::make_error_code(std::errc::bad_file_descriptor) };
+		}
+
+		const auto& handle = this->_file->native_handle();
+#if MMIO_OS_WINDOWS
+		const auto success =
+			::FlushViewOfFile(this->_file->data(), 0) != 0 &&
+			::FlushFileBuffers(handle.file) != 0;
+#elif defined(SYNC_FILE_RANGE_WRITE)
+		// writeback picks up dirty mapped pages on linux, so there is no need for a separate msync
+		const auto success = ::fdatasync(handle.fd) == 0;
+#else
+		const auto success =
+			::msync(this->_file->data(), this->_file->size(), MS_SYNC) == 0 &&
+			::fsync(handle.fd) == 0;
+#endif
+		return { success ?
+			         std::error_code() :
+			         std::make_error_code(detail::decode_os_error()) };
+	}
+
+	auto partitioned_writer::flush(const write_partition& a_partition) noexcept
+		-> open_result
+	{
+		if (!a_partition || !this->_file->is_open()) {
+			return { std::make_error_code(std::errc::invalid_argument) };
+		}
+
+#if MMIO_OS_WINDOWS
+		const auto success = ::FlushViewOfFile(a_partition.data, a_partition.size) != 0;
+#elif defined(SYNC_FILE_RANGE_WRITE)
+		const auto offset = static_cast<::off64_t>(a_partition.offset);
+		const auto size = static_cast<::off64_t>(a_partition.size);
+		const auto success = ::sync_file_range(this->_file->native_handle().fd, offset, size, SYNC_FILE_RANGE_WRITE) == 0;
+#else
+		const auto success = ::msync(a_partition.data, a_partition.size, MS_ASYNC) == 0;
+#endif
+		return { success ?
+			         std::error_code() :
+			         std::make_error_code(detail::decode_os_error()) };
+	}
+
+	auto partitioned_writer::next_partition() noexcept
+		-> write_partition
+	{
+		// a plain load first, so threads polling after the end don't keep bumping the counter
+		if (this->_next.load(std::memory_order_relaxed) >= this->_partitionCount) {
+			return {};
+		}
+
+		const auto index = this->_next.fetch_add(1, std::memory_order_relaxed);
+		if (index >= this->_partitionCount) {
+			return {};
+		}
+
+		const auto offset = index * this->_partitionSize;
+		return {
+			this->_file->data() + offset,
+			offset,
+			(std::min)(this->_partitionSize, this->_file->size() - offset),
+			index
+		};
+	}
+}
@@ -0,0 +1,405 @@
+#include "mmio/record_index.hpp"
+#include "mmio/os.hpp"
+#include "mmio/update.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+	namespace
+	{
+		constexpr char index_magic[8] = { 'M', 'M', 'I', 'O', 'I', 'D', 'X', '\0' };
+		constexpr std::uint32_t index_version = 1;
+
+		// the sidecar is this header followed by `sample_count` native-endian `std::uint64_t` offsets
+		struct index_header final
+		{
+			char magic[8];
+			std::uint32_t version;
+			record_format format;
+			std::uint32_t delimiter;
+			std::uint32_t sample_interval;
+			std::uint64_t source_size;
+			std::int64_t source_mtime;
+			std::uint64_t record_count;
+			std::uint64_t tail_offset;  // where scanning resumes when the source grows
+			std::uint64_t sample_count;
+		};
+
+		static_assert(sizeof(index_header) == 64);
+		static_assert(std::is_trivially_copyable_v<index_header>);
+
+		struct scan_state final
+		{
+			std::vector<std::uint64_t> samples;
+			std::uint64_t records{ 0 };
+			std::uint64_t tail{ 0 };
+		};
+
+		template <class T>
+		[[nodiscard]] auto load(const std::byte* a_src) noexcept
+			-> T
+		{
+			T result;
+			std::memcpy(&result, a_src, sizeof(T));
+			return result;
+		}
+
+		[[nodiscard]] auto load_le32(const std::byte* a_src) noexcept
+			-> std::uint32_t
+		{
+			return std::to_integer<std::uint32_t>(a_src[0]) |
+			       std::to_integer<std::uint32_t>(a_src[1]) << 8 |
+			       std::to_integer<std::uint32_t>(a_src[2]) << 16 |
+			       std::to_integer<std::uint32_t>(a_src[3]) << 24;
+		}
+
+		[[nodiscard]] auto find_delimiter(
+			const std::byte* a_data,
+			std::size_t a_first,
+			std::size_t a_last,
+			std::byte a_delimiter) noexcept
+			-> std::size_t
+		{
+			const auto found = std::memchr(a_data + a_first, std::to_integer<int>(a_delimiter), a_last - a_first);
+			return found != nullptr ?
+			           static_cast<std::size_t>(static_cast<const std::byte*>(found) - a_data) :
+			           a_last;
+		}
+
+		[[nodiscard]] auto index_samples(const mapped_file_source& a_index) noexcept
+			-> const std::byte*
+		{
+			return a_index.data() + sizeof(index_header);
+		}
+
+		[[nodiscard]] auto validated_header(
+			const mapped_file_source& a_index,
+			const record_index_options& a_options) noexcept
+			-> std::optional<index_header>
+		{
+			if (a_index.size() < sizeof(index_header)) {
+				return std::nullopt;
+			}
+
+			const auto header = load<index_header>(a_index.data());
+			const auto interval = header.sample_interval;
+			if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 ||
+				header.version != index_version ||
+				header.format != a_options.format ||
+				header.delimiter != std::to_integer<std::uint32_t>(a_options.delimiter) ||
+				interval != a_options.sample_interval ||
+				header.tail_offset > header.source_size ||
+				header.sample_count != (header.record_count + interval - 1) / interval ||
+				header.sample_count > (a_index.size() - sizeof(index_header)) / sizeof(std::uint64_t)) {
+				return std::nullopt;
+			}
+
+			return header;
+		}
+
+		[[nodiscard]] constexpr auto index_size(const index_header& a_header) noexcept
+			-> std::size_t
+		{
+			return sizeof(index_header) + static_cast<std::size_t>(a_header.sample_count) * sizeof(std::uint64_t);
+		}
+
+		// the header goes in last, so a sidecar with a valid header always has its samples
+		void write_index(
+			std::byte* a_base,
+			const index_header& a_header,
+			std::uint64_t a_kept,
+			const std::vector<std::uint64_t>& a_samples) noexcept
+		{
+			if (!a_samples.empty()) {
+				const auto offset = sizeof(index_header) + static_cast<std::size_t>(a_kept) * sizeof(std::uint64_t);
+				std::memcpy(a_base + offset, a_samples.data(), a_samples.size() * sizeof(std::uint64_t));
+			}
+			std::memcpy(a_base, &a_header, sizeof(a_header));
+		}
+
+		// Writes a new sidecar next to the old one, then renames it into place.
+		// Concurrent refreshes each write their own file, and whichever is renamed last wins.
+		[[nodiscard]] auto rebuild_index(
+			const std::filesystem::path& a_path,
+			const index_header& a_header,
+			const std::vector<std::uint64_t>& a_samples)
+			-> std::error_code
+		{
+			const auto temporary = detail::temporary_path(a_path);
+			std::error_code error;
+			{
+				mapped_file_sink sink;
+				if (auto result = sink.open(temporary, index_size(a_header)); !result) {
+					error = *result;
+				} else {
+					write_index(sink.data(), a_header, 0, a_samples);
+					if (!detail::sync(sink)) {
+						error = std::make_error_code(detail::decode_os_error());
+					}
+				}
+			}
+
+			if (!error) {
+				std::filesystem::rename(temporary, a_path, error);
+			}
+			if (error) {
+				std::error_code ignored;
+				std::filesystem::remove(temporary, ignored);
+			}
+			return error;
+		}
+
+		// Appends samples to a reflinked copy of the sidecar, so only the new samples and the header are written.
+		[[nodiscard]] auto extend_index(
+			const std::filesystem::path& a_path,
+			const index_header& a_header,
+			std::uint64_t a_kept,
+			const std::vector<std::uint64_t>& a_samples) noexcept
+			-> std::error_code
+		{
+			mapped_file_update update;
+			if (auto result = update.begin_update(a_path, index_size(a_header)); !result) {
+				return *result;
+			}
+
+			write_index(update.data(), a_header, a_kept, a_samples);
+			return *update.commit();
+		}
+
+		// indexes every complete record in [a_state.tail, a_size)
+		void scan(
+			const std::byte* a_data,
+			std::size_t a_size,
+			const record_index_options& a_options,
+			scan_state& a_state)
+		{
+			const auto interval = a_options.sample_interval;
+			auto pos = static_cast<std::size_t>(a_state.tail);
+			auto push = [&](std::size_t a_offset) {
+				if (a_state.records++ % interval == 0) {
+					a_state.samples.push_back(a_offset);
+				}
+			};
+
+			switch (a_options.format) {
+			case record_format::delimited:
+				while (pos < a_size) {
+					a_state.tail = pos;
+					push(pos);
+					pos = find_delimiter(a_data, pos, a_size, a_options.delimiter);
+					if (pos == a_size) {
+						return;  // the unterminated record stays at the tail
+					}
+					++pos;
+				}
+				break;
+			case record_format::length_prefixed:
+				while (a_size - pos >= 4 &&
+					   a_size - pos - 4 >= load_le32(a_data + pos)) {
+					push(pos);
+					pos += 4 + load_le32(a_data + pos);
+				}
+				break;
+			}
+
+			a_state.tail = pos;
+		}
+	}
+
+	record_index::record_index(
+		std::filesystem::path a_source,
+		std::filesystem::path a_index,
+		record_index_options a_options)
+	{
+		auto result = this->open(std::move(a_source), std::move(a_index), a_options);
+		if (!result) {
+			throw std::system_error{ *result };
+		}
+	}
+
+	void record_index::close() noexcept
+	{
+		this->_index.close();
+		this->_source.close();
+	}
+
+	auto record_index::offset(std::size_t a_record) const noexcept
+		-> std::size_t
+	{
+		assert(a_record < this->size());
+
+		const auto interval = this->_options.sample_interval;
+		const auto data = this->_source.data();
+		auto pos = static_cast<std::size_t>(load<std::uint64_t>(index_samples(this->_index) + a_record / interval * sizeof(std::uint64_t)));
+		for (auto skip = a_record % interval; skip > 0; --skip) {
+			switch (this->_options.format) {
+			case record_format::delimited:
+				pos = find_delimiter(data, pos, this->_source.size(), this->_options.delimiter) + 1;
+				break;
+			case record_format::length_prefixed:
+				pos += 4 + load_le32(data + pos);
+				break;
+			}
+		}
+
+		return pos;
+	}
+
+	auto record_index::open(
+		std::filesystem::path a_source,
+		std::filesystem::path a_index,
+		record_index_options a_options) noexcept
+		-> open_result
+	{
+		this->close();
+		this->_sourcePath = std::move(a_source);
+		this->_indexPath = std::move(a_index);
+		this->_options = a_options;
+
+		auto error = this->do_refresh();
+		if (error) {
+			this->close();
+		}
+		return { std::move(error) };
+	}
+
+	auto record_index::record(std::size_t a_record) const noexcept
+		-> record_extent
+	{
+		const auto first = this->offset(a_record);
+		const auto data = this->_source.data();
+		switch (this->_options.format) {
+		case record_format::delimited:
+			{
+				const auto last =
+					this->_options.sample_interval == 1 && a_record + 1 < this->size() ?
+						static_cast<std::size_t>(load<std::uint64_t>(index_samples(this->_index) + (a_record + 1) * sizeof(std::uint64_t))) - 1 :
+						find_delimiter(data, first, this->_source.size(), this->_options.delimiter);
+				return { first, last - first };
+			}
+		case record_format::length_prefixed:
+			return { first + 4, load_le32(data + first) };
+		default:
+			assert(false);
+			return {};
+		}
+	}
+
+	auto record_index::refresh() noexcept
+		-> open_result
+	{
+		if (!this->is_open()) {
+			return { std::make_error_code(std::errc::bad_file_descriptor) };
+		}
+
+		auto error = this->do_refresh();
+		if (error) {
+			this->close();
+		}
+		return { std::move(error) };
+	}
+
+	auto record_index::size() const noexcept
+		-> std::size_t
+	{
+		return this->is_open() ?
+		           static_cast<std::size_t>(load<index_header>(this->_index.data()).record_count) :
+		           0;
+	}
+
+	auto record_index::do_refresh() noexcept
+		-> std::error_code
+	{
+		if (this->_options.sample_interval == 0) {
+			return std::make_error_code(std::errc::invalid_argument);
+		}
+
+		// sample the write time first, so that a write racing with us is caught by the next refresh
+		std::error_code error;
+		const auto mtime = std::filesystem::last_write_time(this->_sourcePath, error);
+		if (error) {
+			return error;
+		}
+		const auto size = std::filesystem::file_size(this->_sourcePath, error);
+		if (error) {
+			return error;
+		}
+
+		// empty files can not be mapped, but they are a valid source of 0 records
+		this->_source.close();
+		if (size != 0) {
+			if (auto result = this->_source.open(this->_sourcePath); !result) {
+				return *result;
+			}
+		}
+
+		const auto sourceSize = static_cast<std::uint64_t>(this->_source.size());
+		const auto sourceMtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+
+		if (!this->_index.is_open()) {
+			// a missing or unreadable sidecar is simply rebuilt
+			(void)this->_index.open(this->_indexPath);
+		}
+
+		try {
+			scan_state state;
+			std::uint64_t kept = 0;  // samples which the sidecar already holds, and which stay as they are
+			const auto header = validated_header(this->_index, this->_options);
+			const auto extend = header && header->source_size < sourceSize;
+			if (header && header->source_size == sourceSize && header->source_mtime == sourceMtime) {
+				return {};
+			} else if (extend) {
+				kept = header->sample_count;
+				state.records = header->record_count;
+				state.tail = header->tail_offset;
+
+				// the unterminated record may have been completed, so scan it again
+				if (this->_options.format == record_format::delimited &&
+					state.tail < header->source_size) {
+					if (--state.records % this->_options.sample_interval == 0) {
+						--kept;
+					}
+				}
+			}
+
+			scan(this->_source.data(), static_cast<std::size_t>(sourceSize), this->_options, state);
+
+			const index_header updated{
+				{ index_magic[0], index_magic[1], index_magic[2], index_magic[3], index_magic[4], index_magic[5], index_magic[6], index_magic[7] },
+				index_version,
+				this->_options.format,
+				std::to_integer<std::uint32_t>(this->_options.delimiter),
+				this->_options.sample_interval,
+				sourceSize,
+				sourceMtime,
+				state.records,
+				state.tail,
+				kept + state.samples.size(),
+			};
+
+			// other processes may have the sidecar open, so it is never modified in place
+			this->_index.close();
+			error = extend ?
+			            extend_index(this->_indexPath, updated, kept, state.samples) :
+			            rebuild_index(this->_indexPath, updated, state.samples);
+			if (error) {
+				return error;
+			}
+		} catch (const std::bad_alloc&) {
+			return std::make_error_code(std::errc::not_enough_memory);
+		}
+
+		auto result = this->_index.open(this->_indexPath);
+		return *result;
+	}
+}
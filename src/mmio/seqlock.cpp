@@ -0,0 +1,218 @@
+#include "mmio/seqlock.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace mmio
+{
+	namespace
+	{
+		using counter_t = std::atomic<std::uint32_t>;
+
+		// counters live in memory shared between processes, and are read through read-only mappings
+		static_assert(counter_t::is_always_lock_free);
+		static_assert(sizeof(counter_t) == sizeof(std::uint32_t));
+
+		constexpr char seqlock_magic[8] = { 'M', 'M', 'I', 'O', 'S', 'E', 'Q', '\0' };
+		constexpr std::uint32_t seqlock_layout = 1;
+		constexpr std::size_t cache_line = 64;
+
+		// [header][slot 0][slot 1], where each slot is a cache line holding its sequence and version, then the payload
+		struct seqlock_header final
+		{
+			char magic[8];
+			std::uint32_t layout;
+			std::uint32_t reserved;
+			std::uint64_t payload_size;
+		};
+
+		constexpr std::size_t version_offset = sizeof(seqlock_header);
+		constexpr std::size_t slot_version_offset = sizeof(counter_t);
+
+		[[nodiscard]] constexpr auto slot_stride(std::size_t a_payloadSize) noexcept
+			-> std::size_t
+		{
+			return cache_line + (a_payloadSize + cache_line - 1) / cache_line * cache_line;
+		}
+
+		[[nodiscard]] constexpr auto file_size(std::size_t a_payloadSize) noexcept
+			-> std::size_t
+		{
+			return cache_line + 2 * slot_stride(a_payloadSize);
+		}
+
+		[[nodiscard]] auto counter(const std::byte* a_base, std::size_t a_offset) noexcept
+			-> counter_t&
+		{
+			return *reinterpret_cast<counter_t*>(const_cast<std::byte*>(a_base + a_offset));
+		}
+
+		[[nodiscard]] auto slot_offset(std::size_t a_payloadSize, std::uint32_t a_version) noexcept
+			-> std::size_t
+		{
+			return cache_line + (a_version & 1) * slot_stride(a_payloadSize);
+		}
+
+		[[nodiscard]] bool is_valid(const std::byte* a_base, std::size_t a_size, std::size_t a_payloadSize) noexcept
+		{
+			if (a_size < sizeof(seqlock_header)) {
+				return false;
+			}
+
+			seqlock_header header;
+			std::memcpy(&header, a_base, sizeof(header));
+			return std::memcmp(header.magic, seqlock_magic, sizeof(seqlock_magic)) == 0 &&
+			       header.layout == seqlock_layout &&
+			       header.payload_size == a_payloadSize &&
+			       a_size >= file_size(a_payloadSize);
+		}
+
+		[[nodiscard]] auto stored_payload_size(const std::byte* a_base, std::size_t a_size) noexcept
+			-> std::size_t
+		{
+			if (a_size < sizeof(seqlock_header)) {
+				return 0;
+			}
+
+			seqlock_header header;
+			std::memcpy(&header, a_base, sizeof(header));
+			return static_cast<std::size_t>(header.payload_size);
+		}
+	}
+
+	seqlock_sink::seqlock_sink(
+		std::filesystem::path a_path,
+		std::size_t a_payloadSize)
+	{
+		auto result = this->open(std::move(a_path), a_payloadSize);
+		if (!result) {
+			throw std::system_error{ *result };
+		}
+	}
+
+	auto seqlock_sink::open(
+		std::filesystem::path a_path,
+		std::size_t a_payloadSize) noexcept
+		-> open_result
+	{
+		this->close();
+		this->_payloadSize = a_payloadSize;
+		if (a_payloadSize == 0) {
+			return { std::make_error_code(std::errc::invalid_argument) };
+		}
+
+		// the standard open would start over with an empty file on windows, and lock readers out while it's open
+		if (auto result = this->_file.do_open(std::move(a_path), file_size(a_payloadSize), loadmode::eager, mapped_file_sink::openmode::shared); !result) {
+			return result;
+		}
+
+		const auto base = this->_file.data();
+		if (!is_valid(base, this->_file.size(), a_payloadSize)) {
+			// readers refuse the file until the magic shows up, so write it last
+			std::memset(base, 0, this->_file.size());
+			const seqlock_header header{ {}, seqlock_layout, 0, a_payloadSize };
+			std::memcpy(base, &header, sizeof(header));
+			std::atomic_thread_fence(std::memory_order_release);
+			std::memcpy(base, seqlock_magic, sizeof(seqlock_magic));
+		}
+
+		return { std::error_code() };
+	}
+
+	auto seqlock_sink::publish(const void* a_payload, std::size_t a_size) noexcept
+		-> std::uint32_t
+	{
+		assert(this->is_open());
+		assert(a_size == this->_payloadSize);
+
+		const auto base = this->_file.data();
+		auto& current = counter(base, version_offset);
+		const auto next = current.load(std::memory_order_relaxed) + 1;
+		const auto slot = slot_offset(this->_payloadSize, next);
+		auto& sequence = counter(base, slot);
+
+		// a writer which died mid-publish leaves the sequence odd, so force it odd rather than assume it was even
+		const auto writing = sequence.load(std::memory_order_relaxed) | 1;
+		sequence.store(writing, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(base + slot + slot_version_offset, &next, sizeof(next));
+		std::memcpy(base + slot + cache_line, a_payload, a_size);
+		sequence.store(writing + 1, std::memory_order_release);
+
+		current.store(next, std::memory_order_release);
+		return next;
+	}
+
+	auto seqlock_sink::version() const noexcept
+		-> std::uint32_t
+	{
+		assert(this->is_open());
+		return counter(this->_file.data(), version_offset).load(std::memory_order_acquire);
+	}
+
+	seqlock_source::seqlock_source(std::filesystem::path a_path)
+	{
+		auto result = this->open(std::move(a_path));
+		if (!result) {
+			throw std::system_error{ *result };
+		}
+	}
+
+	auto seqlock_source::open(std::filesystem::path a_path) noexcept
+		-> open_result
+	{
+		this->close();
+		if (auto result = this->_file.do_open(std::move(a_path), dynamic_size, loadmode::eager, mapped_file_source::openmode::shared); !result) {
+			return result;
+		}
+
+		const auto base = this->_file.data();
+		this->_payloadSize = stored_payload_size(base, this->_file.size());
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (this->_payloadSize == 0 || !is_valid(base, this->_file.size(), this->_payloadSize)) {
+			this->close();
+			return { std::make_error_code(std::errc::bad_message) };
+		}
+
+		return { std::error_code() };
+	}
+
+	auto seqlock_source::read(void* a_payload, std::size_t a_size) const noexcept
+		-> std::uint32_t
+	{
+		assert(this->is_open());
+		assert(a_size == this->_payloadSize);
+
+		const auto base = this->_file.data();
+		const auto& current = counter(base, version_offset);
+		for (;;) {
+			const auto slot = slot_offset(this->_payloadSize, current.load(std::memory_order_acquire));
+			const auto& sequence = counter(base, slot);
+
+			const auto begin = sequence.load(std::memory_order_acquire);
+			if ((begin & 1) != 0) {
+				continue;  // the writer has lapped us, and is rewriting this slot
+			}
+			// the slot may have been rewritten since `current` was loaded, so take the version from the slot itself
+			std::uint32_t version;
+			std::memcpy(&version, base + slot + slot_version_offset, sizeof(version));
+			std::memcpy(a_payload, base + slot + cache_line, a_size);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == begin) {
+				return version;
+			}
+		}
+	}
+
+	auto seqlock_source::version() const noexcept
+		-> std::uint32_t
+	{
+		assert(this->is_open());
+		return counter(this->_file.data(), version_offset).load(std::memory_order_acquire);
+	}
+}
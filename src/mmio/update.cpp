@@ -0,0 +1,272 @@
+#include "mmio/update.hpp"
+#include "mmio/os.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <system_error>
+#include <utility>
+
+#if !MMIO_OS_WINDOWS
+#	include <sys/ioctl.h>
+#	ifdef __linux__
+#		include <linux/fs.h>
+#	endif
+#endif
+
+namespace mmio
+{
+	namespace
+	{
+#if MMIO_OS_WINDOWS
+		[[nodiscard]] auto copy_file(
+			const std::filesystem::path& a_from,
+			const std::filesystem::path& a_to,
+			std::size_t a_size) noexcept
+			-> std::error_code
+		{
+			// block clones on ReFS, and does a plain copy everywhere else
+			if (::CopyFileW(a_from.c_str(), a_to.c_str(), TRUE) == 0) {
+				return std::make_error_code(detail::decode_os_error());
+			}
+
+			if (a_size != dynamic_size) {
+				const auto file = ::CreateFileW(
+					a_to.c_str(),
+					GENERIC_WRITE,
+					0,
+					nullptr,
+					OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL,
+					nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					return std::make_error_code(detail::decode_os_error());
+				}
+
+				::LARGE_INTEGER size = {};
+				size.QuadPart = static_cast<::LONGLONG>(a_size);
+				const auto resized =
+					::SetFilePointerEx(file, size, nullptr, FILE_BEGIN) != 0 &&
+					::SetEndOfFile(file) != 0;
+				const auto error = resized ? std::error_code() : std::make_error_code(detail::decode_os_error());
+				[[maybe_unused]] const auto success = ::CloseHandle(file);
+				assert(success != 0);
+				return error;
+			}
+
+			return {};
+		}
+#else
+		class scoped_fd final
+		{
+		public:
+			explicit scoped_fd(int a_fd) noexcept :
+				_fd(a_fd)
+			{}
+
+			scoped_fd(const scoped_fd&) = delete;
+
+			~scoped_fd() noexcept
+			{
+				if (this->_fd != -1) {
+					[[maybe_unused]] const auto success = ::close(this->_fd);
+					assert(success == 0);
+				}
+			}
+
+			scoped_fd& operator=(const scoped_fd&) = delete;
+
+			[[nodiscard]] auto get() const noexcept -> int { return this->_fd; }
+
+		private:
+			int _fd;
+		};
+
+		[[nodiscard]] auto copy_file(
+			const std::filesystem::path& a_from,
+			const std::filesystem::path& a_to,
+			std::size_t a_size) noexcept
+			-> std::error_code
+		{
+			const scoped_fd from{ ::open(a_from.c_str(), O_RDONLY) };
+			if (from.get() == -1) {
+				return std::make_error_code(detail::decode_os_error());
+			}
+
+			struct ::stat s = {};
+			if (::fstat(from.get(), &s) == -1) {
+				return std::make_error_code(detail::decode_os_error());
+			}
+
+			const scoped_fd to{ ::open(a_to.c_str(), O_WRONLY | O_CREAT | O_EXCL, s.st_mode & 0777) };
+			if (to.get() == -1) {
+				return std::make_error_code(detail::decode_os_error());
+			}
+
+			auto remaining = static_cast<std::size_t>(s.st_size);
+#	ifdef FICLONE
+			// shares every extent with the original, until one side writes to it
+			if (::ioctl(to.get(), FICLONE, from.get()) == 0) {
+				remaining = 0;
+			}
+#	endif
+
+			// copy_file_range reflinks too on some filesystems, and at least keeps the copy inside the kernel on the rest
+			bool copyFileRange = true;
+			while (remaining > 0) {
+				::ssize_t result = -1;
+				if (copyFileRange) {
+					result = ::copy_file_range(from.get(), nullptr, to.get(), nullptr, remaining, 0);
+					// some filesystems (procfs, sysfs, some FUSE) report nothing copied rather than an error,
+					// so let read() decide whether the original really ended early
+					if ((result == -1 && (errno == EINVAL || errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP)) ||
+						result == 0) {
+						copyFileRange = false;
+						continue;
+					}
+				} else {
+					// copy_file_range may have gotten partway, so resume from where it left off
+					char buffer[64 * 1024];
+					result = ::read(from.get(), buffer, (std::min)(remaining, sizeof(buffer)));
+					if (result > 0) {
+						for (::ssize_t written = 0; written < result;) {
+							const auto count = ::write(to.get(), buffer + written, static_cast<std::size_t>(result - written));
+							if (count == -1 && errno != EINTR) {
+								return std::make_error_code(detail::decode_os_error());
+							}
+							written += (std::max)(count, ::ssize_t{ 0 });
+						}
+					}
+				}
+
+				if (result == -1) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return std::make_error_code(detail::decode_os_error());
+				} else if (result == 0) {
+					// the original was truncated while we were copying it, so the copy would be too
+					return std::make_error_code(std::errc::io_error);
+				}
+				remaining -= static_cast<std::size_t>(result);
+			}
+
+			if (a_size != dynamic_size && ::ftruncate(to.get(), static_cast<::off_t>(a_size)) == -1) {
+				return std::make_error_code(detail::decode_os_error());
+			}
+
+			return {};
+		}
+
+		[[nodiscard]] bool sync_directory(const std::filesystem::path& a_path) noexcept
+		{
+			const auto parent = a_path.parent_path();
+			const scoped_fd directory{ ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY) };
+			return directory.get() != -1 && ::fsync(directory.get()) == 0;
+		}
+#endif
+	}
+
+	mapped_file_update::mapped_file_update(
+		std::filesystem::path a_path,
+		std::size_t a_size)
+	{
+		auto result = this->begin_update(std::move(a_path), a_size);
+		if (!result) {
+			throw std::system_error{ *result };
+		}
+	}
+
+	void mapped_file_update::abort() noexcept
+	{
+		this->_file.close();
+		if (!this->_temporary.empty()) {
+			std::error_code error;
+			std::filesystem::remove(this->_temporary, error);
+			this->_temporary.clear();
+		}
+		this->_path.clear();
+	}
+
+	auto mapped_file_update::begin_update(
+		std::filesystem::path a_path,
+		std::size_t a_size) noexcept
+		-> open_result
+	{
+		this->abort();
+
+		// there is no mapping an empty file, so fail before making a copy of it
+		if (a_size == 0) {
+			return { std::make_error_code(std::errc::invalid_argument) };
+		} else if (a_size == dynamic_size) {
+			std::error_code error;
+			if (std::filesystem::file_size(a_path, error) == 0 && !error) {
+				return { std::make_error_code(std::errc::invalid_argument) };
+			}
+		}
+
+		try {
+			this->_temporary = detail::temporary_path(a_path);
+		} catch (...) {
+			return { std::make_error_code(std::errc::not_enough_memory) };
+		}
+
+		// abort() also deletes whatever part of the copy was made
+		if (const auto error = copy_file(a_path, this->_temporary, a_size); error) {
+			this->abort();
+			return { error };
+		}
+
+		if (auto result = this->_file.do_open(this->_temporary, dynamic_size, loadmode::eager, mapped_file_sink::openmode::existing); !result) {
+			this->abort();
+			return result;
+		}
+
+		this->_path = std::move(a_path);
+		return { std::error_code() };
+	}
+
+	auto mapped_file_update::commit() noexcept
+		-> open_result
+	{
+		if (!this->is_open()) {
+			return { std::make_error_code(std::errc::bad_file_descriptor) };
+		}
+
+		if (!detail::sync(this->_file)) {
+			const auto error = detail::decode_os_error();
+			this->abort();
+			return { std::make_error_code(error) };
+		}
+
+		this->_file.close();
+#if MMIO_OS_WINDOWS
+		const auto renamed = ::MoveFileExW(
+			this->_temporary.c_str(),
+			this->_path.c_str(),
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+		const auto replaced = renamed != 0;
+#else
+		const auto replaced = ::rename(this->_temporary.c_str(), this->_path.c_str()) == 0;
+#endif
+		if (!replaced) {
+			const auto error = detail::decode_os_error();
+			this->abort();
+			return { std::make_error_code(error) };
+		}
+
+		// the working copy is now the original, so there is nothing left to delete
+		this->_temporary.clear();
+#if MMIO_OS_WINDOWS
+		this->_path.clear();
+#else
+		// the rename itself is only durable once the directory has been flushed
+		if (!sync_directory(std::exchange(this->_path, {}))) {
+			return { std::make_error_code(detail::decode_os_error()) };
+		}
+#endif
+
+		return { std::error_code() };
+	}
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/follow.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	void append(const std::filesystem::path& a_path, std::string_view a_payload)
+	{
+		std::ofstream stream{ a_path, std::ios_base::out | std::ios_base::binary | std::ios_base::app };
+		stream.exceptions(std::ios_base::badbit);
+		stream.write(a_payload.data(), static_cast<std::streamsize>(a_payload.size()));
+	}
+
+	[[nodiscard]] auto contents(const mmio::mapped_file_follower& a_file)
+		-> std::string_view
+	{
+		return { reinterpret_cast<const char*>(a_file.data()), a_file.size() };
+	}
+}
+
+TEST_CASE("following a growing file")
+{
+	const std::filesystem::path root{ "follow"sv };
+	const auto filePath = root / "example.log"sv;
+
+	std::filesystem::create_directories(root);
+	std::filesystem::remove(filePath);
+	append(filePath, ""sv);
+
+	mmio::mapped_file_follower f{ filePath };
+	REQUIRE(f.is_open());
+	REQUIRE(f.empty());
+
+	append(filePath, "first line\n"sv);
+	REQUIRE(f.refresh());
+	REQUIRE(contents(f) == "first line\n"sv);
+
+#ifndef _WIN32
+	const auto base = f.data();
+#endif
+	append(filePath, "second line\n"sv);
+	REQUIRE(f.refresh());
+	REQUIRE(contents(f) == "first line\nsecond line\n"sv);
+#ifndef _WIN32
+	REQUIRE(f.data() == base);
+#endif
+
+	mmio::mapped_file_follower moved{ std::move(f) };
+	REQUIRE(!f.is_open());
+	REQUIRE(moved.size() == 23);
+
+	moved.close();
+	REQUIRE(!moved.is_open());
+	REQUIRE(!moved.refresh());
+}
+
+TEST_CASE("following a file past its reservation")
+{
+	const std::filesystem::path root{ "follow_reserve"sv };
+	const auto filePath = root / "example.log"sv;
+
+	std::filesystem::create_directories(root);
+	std::filesystem::remove(filePath);
+	append(filePath, "header\n"sv);
+
+	mmio::mapped_file_follower f{ filePath, 1 };
+	REQUIRE(contents(f) == "header\n"sv);
+
+	const std::string block(100000, 'x');
+	append(filePath, block);
+	REQUIRE(f.refresh());
+	REQUIRE(f.size() == 7 + block.size());
+	REQUIRE(contents(f).substr(0, 7) == "header\n"sv);
+	REQUIRE(contents(f).substr(7) == block);
+}
+
+TEST_CASE("waiting on a growing file")
+{
+	const std::filesystem::path root{ "follow_wait"sv };
+	const auto filePath = root / "example.log"sv;
+
+	std::filesystem::create_directories(root);
+	std::filesystem::remove(filePath);
+	append(filePath, "a"sv);
+
+	mmio::mapped_file_follower f{ filePath };
+	const auto result = f.wait(10ms);
+	REQUIRE(!result);
+	REQUIRE(*result == std::errc::timed_out);
+
+	std::thread writer{ [&]() {
+		std::this_thread::sleep_for(20ms);
+		append(filePath, "b"sv);
+	} };
+	REQUIRE(f.wait(10s));
+	REQUIRE(contents(f) == "ab"sv);
+	writer.join();
+
+	REQUIRE_THROWS_AS(mmio::mapped_file_follower("follow_wait/missing.log"sv), std::system_error);
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/hash.hpp"
+
+using namespace std::literals;
+
+TEST_CASE("crc32c")
+{
+	REQUIRE(mmio::crc32c(nullptr, 0) == 0);
+	REQUIRE(mmio::crc32c("123456789", 9) == 0xE3069283);
+
+	const auto text = "The quick brown fox jumps over the lazy dog"sv;
+	const auto whole = mmio::crc32c(text.data(), text.size());
+	for (std::size_t split = 0; split <= text.size(); ++split) {
+		const auto first = mmio::crc32c(text.data(), split);
+		const auto second = mmio::crc32c(text.data() + split, text.size() - split);
+		REQUIRE(mmio::crc32c(text.data() + split, text.size() - split, first) == whole);
+		REQUIRE(mmio::crc32c_combine(first, second, text.size() - split) == whole);
+	}
+
+	mmio::crc32c_hasher hasher;
+	hasher.update(text.data(), 10);
+	hasher.update(text.data() + 10, text.size() - 10);
+	REQUIRE(hasher.digest() == whole);
+	hasher.reset();
+	REQUIRE(hasher.digest() == 0);
+}
+
+TEST_CASE("xxh64")
+{
+	REQUIRE(mmio::xxh64(nullptr, 0) == 0xEF46DB3751D8E999);
+	REQUIRE(mmio::xxh64("a", 1) == 0xD24EC4F1A98C6E5B);
+	REQUIRE(mmio::xxh64("abc", 3) == 0x44BC2CF5AD770999);
+
+	std::vector<std::byte> data(1000);
+	for (std::size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<std::byte>(i * 7);
+	}
+
+	for (const std::size_t step : { 1, 3, 31, 32, 33, 100, 1000 }) {
+		mmio::xxh64_hasher hasher{ 42 };
+		for (std::size_t offset = 0; offset < data.size(); offset += step) {
+			hasher.update(data.data() + offset, (std::min)(step, data.size() - offset));
+		}
+		REQUIRE(hasher.digest() == mmio::xxh64(data.data(), data.size(), 42));
+	}
+}
+
+TEST_CASE("parallel hashing")
+{
+	const std::filesystem::path root{ "hash"sv };
+	const auto filePath = root / "data.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	{
+		// deliberately not a multiple of the chunk size
+		mmio::mapped_file_sink sink{ filePath, (std::size_t{ 5 } << 20) + 12345 };
+		const auto data = sink.data();
+		for (std::size_t i = 0; i < sink.size(); ++i) {
+			data[i] = static_cast<std::byte>((i * 131) ^ (i >> 11));
+		}
+	}
+
+	const mmio::mapped_file_source source{ filePath };
+	const auto sequential = mmio::crc32c(source.data(), source.size());
+	REQUIRE(mmio::crc32c(source, { 1 }) == sequential);
+	REQUIRE(mmio::crc32c(source, { 4 }) == sequential);
+	REQUIRE(mmio::crc32c(source) == sequential);
+
+	const auto content = mmio::content_hash(source.data(), source.size(), { 1 });
+	REQUIRE(mmio::content_hash(source, { 3 }) == content);
+	REQUIRE(mmio::content_hash(source) == content);
+	REQUIRE(content != mmio::content_hash(source.data(), source.size() - 1));
+	REQUIRE(mmio::content_hash(nullptr, 0) == mmio::content_hash(nullptr, 0, { 8 }));
+	REQUIRE(mmio::crc32c(nullptr, 0) == mmio::crc32c(mmio::mapped_file_source{}, { 8 }));
+}
@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/hash_map.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	struct point final
+	{
+		double x;
+		double y;
+	};
+
+	struct wide_key final
+	{
+		std::uint64_t lo;
+		std::uint64_t hi;
+	};
+}
+
+TEST_CASE("mapped hash map")
+{
+	const std::filesystem::path root{ "hash_map"sv };
+	const auto filePath = root / "points.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	constexpr std::uint32_t count = 10000;
+	{
+		mmio::mapped_hash_map_builder<std::uint32_t, point> builder;
+		builder.reserve(count + 1);
+		for (std::uint32_t i = 0; i < count; ++i) {
+			builder.insert(i * 3, { i * 0.5, i * 2.0 });
+		}
+		builder.insert(0, { -1.0, -1.0 });
+		REQUIRE(builder.size() == count + 1);
+		REQUIRE(builder.write(filePath));
+	}
+
+	mmio::mapped_hash_map<std::uint32_t, point> map{ filePath };
+	REQUIRE(map.is_open());
+	REQUIRE(map.size() == count);
+
+	for (std::uint32_t i = 1; i < count; ++i) {
+		const auto found = map.find(i * 3);
+		REQUIRE(found != nullptr);
+		REQUIRE(found->x == i * 0.5);
+		REQUIRE(found->y == i * 2.0);
+		REQUIRE(!map.contains(i * 3 + 1));
+	}
+	REQUIRE(map.find(0)->x == -1.0);
+
+	// readers keep the table they opened, while new readers see the replacement
+#ifdef _WIN32
+	map.close();
+#endif
+	{
+		mmio::mapped_hash_map_builder<std::uint32_t, point> builder;
+		builder.insert(1, { 1.0, 1.0 });
+		REQUIRE(builder.write(filePath));
+	}
+#ifndef _WIN32
+	REQUIRE(map.contains(3));
+	REQUIRE(!map.contains(1));
+#endif
+
+	mmio::mapped_hash_map<std::uint32_t, point> replaced{ filePath };
+	REQUIRE(replaced.size() == 1);
+	REQUIRE(replaced.contains(1));
+	REQUIRE(!replaced.contains(3));
+
+	mmio::mapped_hash_map<std::uint32_t, point> moved{ std::move(replaced) };
+	REQUIRE(moved.find(1)->y == 1.0);
+	REQUIRE(!replaced.is_open());
+	REQUIRE(replaced.empty());
+	REQUIRE(!replaced.contains(1));
+
+	replaced = std::move(moved);
+	REQUIRE(replaced.contains(1));
+	REQUIRE(moved.size() == 0);
+	REQUIRE(moved.find(1) == nullptr);
+
+	// no temporary files are left behind
+	for (const auto& entry : std::filesystem::directory_iterator{ root }) {
+		REQUIRE(entry.path() == filePath);
+	}
+}
+
+TEST_CASE("mapped hash maps reject other files")
+{
+	const std::filesystem::path root{ "hash_map_reject"sv };
+	const auto filePath = root / "keys.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	{
+		mmio::mapped_hash_map_builder<wide_key, std::uint16_t> builder;
+		REQUIRE(builder.write(filePath));
+	}
+
+	mmio::mapped_hash_map<wide_key, std::uint16_t> empty{ filePath };
+	REQUIRE(empty.empty());
+	REQUIRE(!empty.contains({ 0, 0 }));
+
+	mmio::mapped_hash_map<wide_key, std::uint32_t> other;
+	const auto result = other.open(filePath);
+	REQUIRE(!result);
+	REQUIRE(*result == std::errc::bad_message);
+	REQUIRE(!other.is_open());
+
+	REQUIRE_THROWS_AS((mmio::mapped_hash_map<std::uint32_t, std::uint16_t>(filePath)), std::system_error);
+}
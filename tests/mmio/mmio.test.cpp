@@ -5,12 +5,18 @@
 #include <iterator>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include <catch2/catch_all.hpp>
 
 #ifdef _WIN32
 #	include <Windows.h>  // ensure windows.h compatibility
+#else
+#	include <fcntl.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
 #endif
 
 #include "mmio/mmio.hpp"
@@ -173,5 +179,137 @@ TEST_CASE("support for ranges")
 	REQUIRE(std::distance(f.begin(), f.end()) == size);
 }
 
+TEST_CASE("lazy mapping")
+{
+	const std::filesystem::path root{ "lazy"sv };
+	const auto filePath = root / "example.txt"sv;
+
+	const char payload[] = "sphinx of black quartz, judge my vow\n";
+	const auto size = sizeof(payload) - 1;
+
+	open_fstream<false>(filePath) << payload;
+
+	mmio::mapped_file_source f{ filePath, mmio::dynamic_size, mmio::loadmode::lazy };
+	REQUIRE(f.is_open());
+	REQUIRE(f.size() == size);
+	REQUIRE(f.load_mode() == mmio::loadmode::lazy);
+#ifdef _WIN32
+	REQUIRE(f.native_handle().base_address == nullptr);
+#else
+	REQUIRE(f.native_handle().addr == mmio::native_handle_type::map_failed);
+#endif
+	REQUIRE(f.data() == nullptr);
+
+	std::vector<const std::byte*> seen(4);
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < seen.size(); ++i) {
+		threads.emplace_back([&, i]() { seen[i] = f.map(); });
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (const auto data : seen) {
+		REQUIRE(data != nullptr);
+		REQUIRE(data == f.data());
+	}
+	REQUIRE(std::memcmp(f.data(), payload, size) == 0);
+
+	assert_movable(f, size);
+
+	f.unmap_idle();
+	REQUIRE(f.is_open());
+#ifdef _WIN32
+	REQUIRE(f.native_handle().base_address == nullptr);
+#else
+	REQUIRE(f.native_handle().addr == mmio::native_handle_type::map_failed);
+#endif
+	REQUIRE(f.data() == nullptr);
+	REQUIRE(std::distance(f.begin(), f.end()) == size);
+	REQUIRE(f.begin() == f.data());
+	REQUIRE(std::memcmp(f.data(), payload, size) == 0);
+	REQUIRE(f.map() == f.data());
+
+	f.close();
+	assert_closed(f);
+	REQUIRE(f.load_mode() == mmio::loadmode::eager);
+
+	// an eager mapping which is unmapped comes back on demand
+	REQUIRE(f.open(filePath));
+	f.unmap_idle();
+	REQUIRE(f.load_mode() == mmio::loadmode::lazy);
+	std::size_t count = 0;
+	for ([[maybe_unused]] const auto byte : f) {
+		++count;
+	}
+	REQUIRE(count == size);
+	REQUIRE(std::memcmp(f.data(), payload, size) == 0);
+
+	mmio::mapped_file_sink sink;
+	REQUIRE(sink.open(root / "sink.txt"sv, size, mmio::loadmode::lazy));
+	std::memcpy(sink.map(), payload, size);
+	sink.unmap_idle();
+	REQUIRE(std::memcmp(sink.map(), payload, size) == 0);
+
+	(void)open_fstream<false>(root / "empty.txt"sv);
+	REQUIRE(!f.open(root / "empty.txt"sv, mmio::dynamic_size, mmio::loadmode::lazy));
+	assert_closed(f);
+}
+
+#ifndef _WIN32
+TEST_CASE("zero-copy export of mapped ranges")
+{
+	const std::filesystem::path root{ "export"sv };
+	const auto sourcePath = root / "source.txt"sv;
+	const auto targetPath = root / "target.txt"sv;
+
+	const char payload[] = "pack my box with five dozen liquor jugs\n";
+	const auto size = sizeof(payload) - 1;
+
+	open_fstream<false>(sourcePath) << payload;
+	mmio::mapped_file_source f{ sourcePath };
+
+	const auto target = ::open(targetPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	REQUIRE(target != -1);
+	auto result = f.copy_to(target, 5, 6);
+	REQUIRE(result);
+	REQUIRE(result.transferred() == 6);
+	result = f.copy_to(target, 0, size);
+	REQUIRE(result);
+	REQUIRE(result.transferred() == size);
+	::close(target);
+
+	std::string read;
+	read.resize(6 + size);
+	open_fstream<true>(targetPath).read(read.data(), read.size());
+	REQUIRE(read == "my box"s + payload);
+
+	int sockets[2] = {};
+	REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+	result = f.send_to(sockets[0], 12, 4);
+	REQUIRE(result);
+	REQUIRE(result.transferred() == 4);
+	char received[4] = {};
+	REQUIRE(::read(sockets[1], received, sizeof(received)) == sizeof(received));
+	REQUIRE(std::string_view(received, sizeof(received)) == "with"sv);
+	::close(sockets[0]);
+	::close(sockets[1]);
+
+	// pipes are neither regular files nor sockets, so only the fallbacks apply
+	int pipes[2] = {};
+	REQUIRE(::pipe(pipes) == 0);
+	result = f.copy_to(pipes[1], 0, 4);
+	REQUIRE(result);
+	char piped[4] = {};
+	REQUIRE(::read(pipes[0], piped, sizeof(piped)) == sizeof(piped));
+	REQUIRE(std::string_view(piped, sizeof(piped)) == "pack"sv);
+	::close(pipes[0]);
+	::close(pipes[1]);
+
+	REQUIRE(!f.copy_to(-1, 0, size));
+	REQUIRE(!f.copy_to(-1, 1, size));
+	REQUIRE(f.copy_to(-1, 1, size).transferred() == 0);
+}
+#endif
+
 static_assert(std::is_move_assignable_v<mmio::open_result>);
 static_assert(std::is_move_constructible_v<mmio::open_result>);
@@ -0,0 +1,80 @@
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/partition.hpp"
+
+using namespace std::literals;
+
+TEST_CASE("partitioned writes")
+{
+	const std::filesystem::path root{ "partition"sv };
+	const auto filePath = root / "output.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	constexpr std::size_t fileSize = (std::size_t{ 1 } << 20) + 777;
+	{
+		mmio::mapped_file_sink sink{ filePath, fileSize };
+		mmio::partitioned_writer writer{ sink, 1000 };
+		REQUIRE(writer.partition_size() >= 1000);
+		REQUIRE(writer.partition_count() == (fileSize + writer.partition_size() - 1) / writer.partition_size());
+
+		std::atomic_size_t claimed{ 0 };
+		std::atomic_bool failed{ false };
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i) {
+			threads.emplace_back([&]() {
+				while (const auto partition = writer.next_partition()) {
+					if (partition.offset % writer.partition_size() != 0 ||
+						partition.offset != partition.index * writer.partition_size()) {
+						failed = true;
+					}
+					for (std::size_t j = 0; j < partition.size; ++j) {
+						partition.data[j] = static_cast<std::byte>((partition.offset + j) % 251);
+					}
+					if (!writer.flush(partition)) {
+						failed = true;
+					}
+					++claimed;
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		REQUIRE(!failed);
+		REQUIRE(claimed == writer.partition_count());
+		REQUIRE(!writer.next_partition());
+		REQUIRE(!writer.flush({}));
+		REQUIRE(writer.finish());
+	}
+
+	const mmio::mapped_file_source source{ filePath };
+	REQUIRE(source.size() == fileSize);
+	for (std::size_t i = 0; i < source.size(); ++i) {
+		if (source.data()[i] != static_cast<std::byte>(i % 251)) {
+			FAIL("mismatch at " << i);
+		}
+	}
+}
+
+TEST_CASE("partitioned writes need an open sink")
+{
+	mmio::mapped_file_sink sink;
+	mmio::partitioned_writer writer{ sink, 4096 };
+	REQUIRE(writer.partition_count() == 0);
+	REQUIRE(!writer.next_partition());
+
+	const auto result = writer.finish();
+	REQUIRE(!result);
+	REQUIRE(*result == std::errc::bad_file_descriptor);
+}
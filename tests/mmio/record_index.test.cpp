@@ -0,0 +1,171 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/record_index.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	void write_file(
+		const std::filesystem::path& a_path,
+		std::string_view a_payload,
+		bool a_append = false)
+	{
+		std::filesystem::create_directories(a_path.parent_path());
+		const auto openMode = a_append ? std::ios_base::app : std::ios_base::trunc;
+		std::ofstream stream{ a_path, std::ios_base::out | std::ios_base::binary | openMode };
+		stream.exceptions(std::ios_base::badbit);
+		stream.write(a_payload.data(), static_cast<std::streamsize>(a_payload.size()));
+	}
+
+	[[nodiscard]] auto record_string(const mmio::record_index& a_index, std::size_t a_record)
+		-> std::string_view
+	{
+		const auto extent = a_index[a_record];
+		return { reinterpret_cast<const char*>(a_index.source().data()) + extent.offset, extent.size };
+	}
+
+	void assert_records(const mmio::record_index& a_index, const std::vector<std::string_view>& a_records)
+	{
+		REQUIRE(a_index.size() == a_records.size());
+		for (std::size_t i = 0; i < a_records.size(); ++i) {
+			REQUIRE(record_string(a_index, i) == a_records[i]);
+		}
+	}
+
+	[[nodiscard]] auto length_prefixed(std::string_view a_payload)
+		-> std::string
+	{
+		const auto size = static_cast<std::uint32_t>(a_payload.size());
+		std::string result{
+			static_cast<char>(size & 0xFF),
+			static_cast<char>((size >> 8) & 0xFF),
+			static_cast<char>((size >> 16) & 0xFF),
+			static_cast<char>((size >> 24) & 0xFF),
+		};
+		result += a_payload;
+		return result;
+	}
+}
+
+TEST_CASE("record index over delimited records")
+{
+	const std::filesystem::path root{ "record_index_delimited"sv };
+	const auto sourcePath = root / "example.txt"sv;
+	const auto indexPath = root / "example.idx"sv;
+
+	std::filesystem::remove(indexPath);
+	write_file(sourcePath, "alpha\nbeta\n\ngamma\ndelta"sv);
+
+	for (const std::uint32_t interval : { 1u, 2u, 3u }) {
+		mmio::record_index_options options;
+		options.sample_interval = interval;
+
+		mmio::record_index index{ sourcePath, indexPath, options };
+		REQUIRE(index.is_open());
+		assert_records(index, { "alpha"sv, "beta"sv, ""sv, "gamma"sv, "delta"sv });
+		REQUIRE(index.offset(3) == 12);
+	}
+
+	const auto sidecarSize = std::filesystem::file_size(indexPath);
+	mmio::record_index_options sampled;
+	sampled.sample_interval = 3;
+	mmio::record_index index;
+	REQUIRE(index.open(sourcePath, indexPath, sampled));
+	REQUIRE(std::filesystem::file_size(indexPath) == sidecarSize);
+
+	index.close();
+	REQUIRE(!index.is_open());
+	REQUIRE(index.empty());
+}
+
+TEST_CASE("record index grows with its source")
+{
+	const std::filesystem::path root{ "record_index_growth"sv };
+	const auto sourcePath = root / "example.log"sv;
+	const auto indexPath = root / "example.log.idx"sv;
+
+	std::filesystem::remove(indexPath);
+	write_file(sourcePath, ""sv);
+
+	mmio::record_index_options options;
+	options.sample_interval = 2;
+	mmio::record_index index{ sourcePath, indexPath, options };
+	REQUIRE(index.empty());
+
+	write_file(sourcePath, "one\ntw"sv, true);
+	REQUIRE(index.refresh());
+	assert_records(index, { "one"sv, "tw"sv });
+
+#ifndef _WIN32
+	// another reader keeps the sidecar it opened, untouched by the refresh replacing it
+	const mmio::record_index reader{ sourcePath, indexPath, options };
+#endif
+	write_file(sourcePath, "o\nthree\nfour\n"sv, true);
+	REQUIRE(index.refresh());
+	assert_records(index, { "one"sv, "two"sv, "three"sv, "four"sv });
+#ifndef _WIN32
+	REQUIRE(reader.size() == 2);
+	REQUIRE(reader.offset(1) == 4);
+#endif
+
+	std::size_t files = 0;
+	for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator{ root }) {
+		++files;
+	}
+	REQUIRE(files == 2);
+
+	// a freshly opened index must agree with the incrementally extended one
+	index.close();
+	std::filesystem::remove(indexPath);
+	REQUIRE(index.open(sourcePath, indexPath, options));
+	assert_records(index, { "one"sv, "two"sv, "three"sv, "four"sv });
+
+	// a source which shrank can not have been appended to, so it is rebuilt from scratch
+	index.close();
+	write_file(sourcePath, "five\n"sv);
+	REQUIRE(index.open(sourcePath, indexPath, options));
+	assert_records(index, { "five"sv });
+}
+
+TEST_CASE("record index over length prefixed records")
+{
+	const std::filesystem::path root{ "record_index_length_prefixed"sv };
+	const auto sourcePath = root / "example.bin"sv;
+	const auto indexPath = root / "example.bin.idx"sv;
+
+	std::filesystem::remove(indexPath);
+	const auto second = length_prefixed("second\nrecord"sv);
+	write_file(sourcePath, length_prefixed("first"sv) + second.substr(0, 6));
+
+	mmio::record_index_options options;
+	options.format = mmio::record_format::length_prefixed;
+	mmio::record_index index{ sourcePath, indexPath, options };
+	assert_records(index, { "first"sv });
+
+	write_file(sourcePath, second.substr(6) + length_prefixed(""sv), true);
+	REQUIRE(index.refresh());
+	assert_records(index, { "first"sv, "second\nrecord"sv, ""sv });
+	REQUIRE(index.offset(1) == 9);
+}
+
+TEST_CASE("record index reports errors")
+{
+	mmio::record_index index;
+	REQUIRE(!index.refresh());
+	REQUIRE(!index.open("record_index_missing/none.txt"sv, "record_index_missing/none.idx"sv));
+
+	mmio::record_index_options options;
+	options.sample_interval = 0;
+	REQUIRE_THROWS_AS(mmio::record_index("record_index_missing/none.txt"sv, "record_index_missing/none.idx"sv, options), std::system_error);
+}
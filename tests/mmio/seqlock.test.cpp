@@ -0,0 +1,148 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/seqlock.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	struct snapshot final
+	{
+		std::uint64_t values[32];
+	};
+}
+
+TEST_CASE("seqlock publication")
+{
+	const std::filesystem::path root{ "seqlock"sv };
+	const auto filePath = root / "state.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	mmio::seqlock_sink sink{ filePath, sizeof(snapshot) };
+	REQUIRE(sink.is_open());
+	REQUIRE(sink.version() == 0);
+
+	mmio::seqlock_source source{ filePath };
+	REQUIRE(source.payload_size() == sizeof(snapshot));
+	REQUIRE(source.read<snapshot>().values[0] == 0);
+
+	snapshot value{};
+	for (auto& v : value.values) {
+		v = 42;
+	}
+	REQUIRE(sink.publish(value) == 1);
+	REQUIRE(source.version() == 1);
+	REQUIRE(source.read<snapshot>().values[31] == 42);
+
+	// reopening the sink keeps what was last published
+	sink.close();
+	REQUIRE(sink.open(filePath, sizeof(snapshot)));
+	REQUIRE(sink.version() == 1);
+	REQUIRE(source.read<snapshot>().values[0] == 42);
+}
+
+TEST_CASE("seqlock readers never observe torn writes")
+{
+	const std::filesystem::path root{ "seqlock_torn"sv };
+	const auto filePath = root / "state.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	mmio::seqlock_sink sink{ filePath, sizeof(snapshot) };
+	constexpr std::uint32_t publications = 20000;
+	std::atomic_bool torn{ false };
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; ++i) {
+		readers.emplace_back([&]() {
+			mmio::seqlock_source source{ filePath };
+			std::uint32_t last = 0;
+			while (last < publications) {
+				snapshot value;
+				const auto version = source.read(&value, sizeof(value));
+				for (const auto v : value.values) {
+					if (v != version || version < last) {
+						torn = true;
+					}
+				}
+				last = version;
+			}
+		});
+	}
+
+	for (std::uint32_t i = 1; i <= publications; ++i) {
+		snapshot value;
+		for (auto& v : value.values) {
+			v = i;
+		}
+		sink.publish(value);
+	}
+
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	REQUIRE(!torn);
+}
+
+TEST_CASE("seqlock recovers from a writer dying mid-publish")
+{
+	const std::filesystem::path root{ "seqlock_recovery"sv };
+	const auto filePath = root / "state.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+
+	mmio::seqlock_sink sink{ filePath, sizeof(std::uint64_t) };
+	REQUIRE(sink.publish(std::uint64_t{ 1 }) == 1);
+	sink.close();
+
+	// the next publication goes to slot 0, which a dead writer left with an odd sequence
+	{
+		mmio::mapped_file_sink raw{ filePath };
+		const std::uint32_t sequence = 1;
+		std::memcpy(raw.data() + 64, &sequence, sizeof(sequence));
+	}
+
+	REQUIRE(sink.open(filePath, sizeof(std::uint64_t)));
+	REQUIRE(sink.publish(std::uint64_t{ 2 }) == 2);
+
+	const mmio::seqlock_source source{ filePath };
+	std::uint64_t value = 0;
+	REQUIRE(source.read(&value, sizeof(value)) == 2);
+	REQUIRE(value == 2);
+
+	REQUIRE(sink.publish(std::uint64_t{ 3 }) == 3);
+	REQUIRE(source.read<std::uint64_t>() == 3);
+}
+
+TEST_CASE("seqlock sources reject other files")
+{
+	const std::filesystem::path root{ "seqlock_invalid"sv };
+	const auto filePath = root / "state.bin"sv;
+
+	std::filesystem::remove(filePath);
+	std::filesystem::create_directories(root);
+	{
+		mmio::mapped_file_sink f{ filePath, 256 };
+	}
+
+	mmio::seqlock_source source;
+	const auto result = source.open(filePath);
+	REQUIRE(!result);
+	REQUIRE(*result == std::errc::bad_message);
+	REQUIRE(!source.is_open());
+
+	REQUIRE_THROWS_AS(mmio::seqlock_sink(filePath, 0), std::system_error);
+}
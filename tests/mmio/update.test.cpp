@@ -0,0 +1,125 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <catch2/catch_all.hpp>
+
+#include "mmio/update.hpp"
+
+using namespace std::literals;
+
+namespace
+{
+	void write(const std::filesystem::path& a_path, std::string_view a_payload)
+	{
+		std::ofstream stream{ a_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc };
+		stream.exceptions(std::ios_base::badbit);
+		stream.write(a_payload.data(), static_cast<std::streamsize>(a_payload.size()));
+	}
+
+	[[nodiscard]] auto contents(const mmio::mapped_file_source& a_file)
+		-> std::string_view
+	{
+		return { reinterpret_cast<const char*>(a_file.data()), a_file.size() };
+	}
+
+	[[nodiscard]] auto entries(const std::filesystem::path& a_directory)
+		-> std::size_t
+	{
+		std::size_t result = 0;
+		for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator{ a_directory }) {
+			++result;
+		}
+		return result;
+	}
+}
+
+TEST_CASE("atomic updates")
+{
+	const std::filesystem::path root{ "update"sv };
+	const auto filePath = root / "data.bin"sv;
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	write(filePath, "hello world"sv);
+
+#ifndef _WIN32
+	const mmio::mapped_file_source reader{ filePath };
+#endif
+
+	mmio::mapped_file_update update{ filePath };
+	REQUIRE(update.is_open());
+	REQUIRE(update.path() == filePath);
+	REQUIRE(update.size() == 11);
+	std::memcpy(update.data(), "HELLO", 5);
+
+	// edits stay private until they are committed
+#ifndef _WIN32
+	REQUIRE(contents(reader) == "hello world"sv);
+#endif
+	REQUIRE(contents(mmio::mapped_file_source{ filePath }) == "hello world"sv);
+	REQUIRE(entries(root) == 2);
+
+	REQUIRE(update.commit());
+	REQUIRE(!update.is_open());
+	REQUIRE(!update.commit());
+	REQUIRE(entries(root) == 1);
+
+#ifndef _WIN32
+	REQUIRE(contents(reader) == "hello world"sv);
+#endif
+	REQUIRE(contents(mmio::mapped_file_source{ filePath }) == "HELLO world"sv);
+}
+
+TEST_CASE("aborted and resized updates")
+{
+	const std::filesystem::path root{ "update_abort"sv };
+	const auto filePath = root / "data.bin"sv;
+
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	write(filePath, "0123456789"sv);
+
+	{
+		mmio::mapped_file_update update{ filePath };
+		std::memcpy(update.data(), "xx", 2);
+
+		mmio::mapped_file_update moved{ std::move(update) };
+		REQUIRE(!update.is_open());
+		REQUIRE(moved.is_open());
+	}
+	REQUIRE(entries(root) == 1);
+	REQUIRE(contents(mmio::mapped_file_source{ filePath }) == "0123456789"sv);
+
+	mmio::mapped_file_update shrink{ filePath, 4 };
+	REQUIRE(shrink.size() == 4);
+	REQUIRE(shrink.commit());
+	REQUIRE(contents(mmio::mapped_file_source{ filePath }) == "0123"sv);
+
+	mmio::mapped_file_update grow{ filePath, 6 };
+	REQUIRE(grow.size() == 6);
+	std::memcpy(grow.data() + 4, "45", 2);
+	REQUIRE(grow.commit());
+	REQUIRE(contents(mmio::mapped_file_source{ filePath }) == "012345"sv);
+
+	REQUIRE_THROWS_AS(mmio::mapped_file_update("update_abort/missing.bin"sv), std::system_error);
+	REQUIRE(entries(root) == 1);
+
+	const auto emptyPath = root / "empty.bin"sv;
+	write(emptyPath, ""sv);
+	mmio::mapped_file_update empty;
+	const auto result = empty.begin_update(emptyPath);
+	REQUIRE(!result);
+	REQUIRE(*result == std::errc::invalid_argument);
+	REQUIRE(!empty.begin_update(filePath, 0));
+	REQUIRE(entries(root) == 2);
+
+	REQUIRE(empty.begin_update(emptyPath, 3));
+	std::memcpy(empty.data(), "abc", 3);
+	REQUIRE(empty.commit());
+	REQUIRE(contents(mmio::mapped_file_source{ emptyPath }) == "abc"sv);
+}